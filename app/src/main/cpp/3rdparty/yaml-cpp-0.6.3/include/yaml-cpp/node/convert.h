@@ -8,12 +8,30 @@
 #endif
 
 #include <array>
+#include <cerrno>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
 #include <limits>
 #include <list>
 #include <map>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
+// std::from_chars() and std::to_chars() read and write numbers without a stream or a
+// locale. Integers have them wherever <charconv> exists; floating-point numbers only
+// where __cpp_lib_to_chars says so, and go through the C library elsewhere.
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#define YAML_CPP_HAS_CHARCONV
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define YAML_CPP_HAS_FLOAT_CHARCONV
+#endif
+#endif
+#endif
+
 #include "yaml-cpp/binary.h"
 #include "yaml-cpp/node/impl.h"
 #include "yaml-cpp/node/iterator.h"
@@ -43,6 +61,262 @@ namespace YAML {
         inline bool IsNaN(const std::string &input) {
             return input == ".nan" || input == ".NaN" || input == ".NAN";
         }
+
+        // Reads `input` like `stream >> std::noskipws >> rhs` on a stringstream with no
+        // basefield, so that 0x1F is hexadecimal and 010 octal, followed by nothing but
+        // whitespace. This is what convert<T>::decode() used to build a stream for; the
+        // overloads below do the same without one.
+        template<typename T>
+        bool ReadNumber(const std::string &input, T &rhs) {
+            std::stringstream stream(input);
+            stream.unsetf(std::ios::dec);
+            return (stream >> std::noskipws >> rhs) && (stream >> std::ws).eof();
+        }
+
+        // Writes `rhs` like `stream << rhs` with a precision of max_digits10.
+        template<typename T>
+        std::string WriteNumber(const T &rhs) {
+            std::stringstream stream;
+            stream.precision(std::numeric_limits<T>::max_digits10);
+            stream << rhs;
+            return stream.str();
+        }
+
+        // Whether only what std::ws skips is left.
+        inline bool IsStreamEnd(const char *begin, const char *end) {
+            for (; begin != end; ++begin) {
+                if (*begin != ' ' && (*begin < '\t' || *begin > '\r'))
+                    return false;
+            }
+            return true;
+        }
+
+#ifdef YAML_CPP_HAS_CHARCONV
+        // A sign, then 0x and hexadecimal digits, 0 and octal digits or decimal digits.
+        // Out of range values fail; negative ones wrap around in unsigned types, as they
+        // do with strtoull().
+        template<typename T>
+        bool ReadInteger(const std::string &input, T &rhs) {
+            typedef typename std::make_unsigned<T>::type Magnitude;
+            const char *begin = input.data();
+            const char *end = begin + input.size();
+            bool negative = false;
+            if (begin != end && (*begin == '-' || *begin == '+'))
+                negative = *begin++ == '-';
+            int base = 10;
+            if (begin != end && *begin == '0') {
+                base = 8;
+                if (end - begin > 1 && (begin[1] == 'x' || begin[1] == 'X')) {
+                    base = 16;
+                    begin += 2;
+                }
+            }
+            Magnitude magnitude;
+            std::from_chars_result result = std::from_chars(begin, end, magnitude, base);
+            if (result.ec != std::errc() || !IsStreamEnd(result.ptr, end))
+                return false;
+            if (std::is_unsigned<T>::value) {
+                rhs = static_cast<T>(negative ? Magnitude(0) - magnitude : magnitude);
+                return true;
+            }
+            const Magnitude max = static_cast<Magnitude>(std::numeric_limits<T>::max());
+            if (magnitude > max + Magnitude(negative))
+                return false;
+            rhs = negative && magnitude != 0 ? static_cast<T>(-static_cast<T>(magnitude - 1) - 1)
+                                             : static_cast<T>(magnitude);
+            return true;
+        }
+
+        template<typename T>
+        std::string WriteInteger(T rhs) {
+            char buffer[std::numeric_limits<T>::digits10 + 3];
+            return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), rhs).ptr);
+        }
+
+        // A sign, then digits with an optional point and exponent, like the stream reads
+        // them; not inf, nan or hexadecimal. Returns 1 if `rhs` was read, 0 if `input` is
+        // not such a number and -1 if it over- or underflows, which standard libraries
+        // disagree on: the stream decides those.
+        template<typename T>
+        int ParseFloatingPoint(const std::string &input, T &rhs) {
+            const char *begin = input.data();
+            const char *end = begin + input.size();
+            bool negative = false;
+            if (begin != end && (*begin == '-' || *begin == '+'))
+                negative = *begin++ == '-';
+            if (begin == end || !((*begin >= '0' && *begin <= '9') || *begin == '.'))
+                return 0;
+            T value;
+#ifdef YAML_CPP_HAS_FLOAT_CHARCONV
+            std::from_chars_result result = std::from_chars(begin, end, value);
+            if (result.ec == std::errc::result_out_of_range)
+                return -1;
+            if (result.ec != std::errc() || !IsStreamEnd(result.ptr, end))
+                return 0;
+#else
+            // The C library reads hexadecimal too, so the syntax is checked first.
+            const char *digits = begin;
+            const char *last = begin;
+            while (last != end && *last >= '0' && *last <= '9')
+                ++last;
+            bool hasDigits = last != digits;
+            if (last != end && *last == '.') {
+                digits = ++last;
+                while (last != end && *last >= '0' && *last <= '9')
+                    ++last;
+                hasDigits = hasDigits || last != digits;
+            }
+            if (!hasDigits)
+                return 0;
+            if (last != end && (*last == 'e' || *last == 'E')) {
+                const char *exponent = last + 1;
+                if (exponent != end && (*exponent == '-' || *exponent == '+'))
+                    ++exponent;
+                digits = exponent;
+                while (exponent != end && *exponent >= '0' && *exponent <= '9')
+                    ++exponent;
+                if (exponent != digits)
+                    last = exponent;
+            }
+            if (!IsStreamEnd(last, end))
+                return 0;
+            if (*std::localeconv()->decimal_point != '.')
+                return -1;
+            const std::string number(begin, last);
+            char *parsed;
+            errno = 0;
+            value = std::is_same<T, float>::value ? std::strtof(number.c_str(), &parsed)
+                                                  : std::strtod(number.c_str(), &parsed);
+            if (errno == ERANGE)
+                return -1;
+            if (parsed != number.c_str() + number.size())
+                return 0;
+#endif
+            rhs = negative ? -value : value;
+            return 1;
+        }
+
+        template<typename T>
+        bool ReadFloatingPoint(const std::string &input, T &rhs) {
+            int parsed = ParseFloatingPoint(input, rhs);
+            return parsed < 0 ? ReadNumber<T>(input, rhs) : parsed == 1;
+        }
+
+        // What printf("%.*g") writes with max_digits10, like the stream.
+        template<typename T>
+        std::string WriteFloatingPoint(T rhs) {
+            const int precision = std::numeric_limits<T>::max_digits10;
+            char buffer[32];  // Enough for -d.dddde-ddd at any precision here.
+#ifdef YAML_CPP_HAS_FLOAT_CHARCONV
+            return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), rhs,
+                                                     std::chars_format::general, precision).ptr);
+#else
+            if (*std::localeconv()->decimal_point != '.')
+                return WriteNumber<T>(rhs);
+            int length = std::snprintf(buffer, sizeof(buffer), "%.*g", precision,
+                                       static_cast<double>(rhs));
+            return std::string(buffer, static_cast<std::size_t>(length));
+#endif
+        }
+
+        inline bool ReadNumber(const std::string &input, short &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, int &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, long &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, long long &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, unsigned short &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, unsigned &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, unsigned long &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, unsigned long long &rhs) {
+            return ReadInteger(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, float &rhs) {
+            return ReadFloatingPoint(input, rhs);
+        }
+
+        inline bool ReadNumber(const std::string &input, double &rhs) {
+            return ReadFloatingPoint(input, rhs);
+        }
+
+        inline std::string WriteNumber(short rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(int rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(long rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(long long rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(unsigned short rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(unsigned rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(unsigned long rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(unsigned long long rhs) { return WriteInteger(rhs); }
+
+        inline std::string WriteNumber(float rhs) { return WriteFloatingPoint(rhs); }
+
+        inline std::string WriteNumber(double rhs) { return WriteFloatingPoint(rhs); }
+#endif
+
+        // -infinity where T is signed. Unsigned types have no infinity, but negating one of
+        // them is a warning (C4146) even where it cannot be reached.
+        template<typename T>
+        T NegativeInfinity(std::true_type /* is_signed */) {
+            return -std::numeric_limits<T>::infinity();
+        }
+
+        template<typename T>
+        T NegativeInfinity(std::false_type /* is_signed */) {
+            return +std::numeric_limits<T>::infinity();
+        }
+
+        // Reads the text of a scalar as a number, for convert<T>::decode() and for
+        // scalars which are not in a node, such as those of an EventHandler.
+        template<typename T>
+        bool DecodeStreamable(const std::string &input, T &rhs) {
+            if (ReadNumber(input, rhs))
+                return true;
+            if (std::numeric_limits<T>::has_infinity) {
+                if (IsInfinity(input)) {
+                    rhs = std::numeric_limits<T>::infinity();
+                    return true;
+                } else if (IsNegativeInfinity(input)) {
+                    rhs = NegativeInfinity<T>(std::is_signed<T>());
+                    return true;
+                }
+            }
+
+            if (std::numeric_limits<T>::has_quiet_NaN) {
+                if (IsNaN(input)) {
+                    rhs = std::numeric_limits<T>::quiet_NaN();
+                    return true;
+                }
+            }
+
+            return false;
+        }
     }
 
 // Node
@@ -89,81 +363,48 @@ namespace YAML {
         }
     };
 
-#define YAML_DEFINE_CONVERT_STREAMABLE(type, negative_op)                \
-  template <>                                                            \
-  struct convert<type> {                                                 \
-    static Node encode(const type& rhs) {                                \
-      std::stringstream stream;                                          \
-      stream.precision(std::numeric_limits<type>::max_digits10);         \
-      stream << rhs;                                                     \
-      return Node(stream.str());                                         \
-    }                                                                    \
-                                                                         \
-    static bool decode(const Node& node, type& rhs) {                    \
-      if (node.Type() != NodeType::Scalar)                               \
-        return false;                                                    \
-      const std::string& input = node.Scalar();                          \
-      std::stringstream stream(input);                                   \
-      stream.unsetf(std::ios::dec);                                      \
-      if ((stream >> std::noskipws >> rhs) && (stream >> std::ws).eof()) \
-        return true;                                                     \
-      if (std::numeric_limits<type>::has_infinity) {                     \
-        if (conversion::IsInfinity(input)) {                             \
-          rhs = std::numeric_limits<type>::infinity();                   \
-          return true;                                                   \
-        } else if (conversion::IsNegativeInfinity(input)) {              \
-          rhs = negative_op std::numeric_limits<type>::infinity();       \
-          return true;                                                   \
-        }                                                                \
-      }                                                                  \
-                                                                         \
-      if (std::numeric_limits<type>::has_quiet_NaN) {                    \
-        if (conversion::IsNaN(input)) {                                  \
-          rhs = std::numeric_limits<type>::quiet_NaN();                  \
-          return true;                                                   \
-        }                                                                \
-      }                                                                  \
-                                                                         \
-      return false;                                                      \
-    }                                                                    \
+#define YAML_DEFINE_CONVERT_STREAMABLE(type)                     \
+  template <>                                                    \
+  struct convert<type> {                                         \
+    static Node encode(const type& rhs) {                        \
+      return Node(conversion::WriteNumber(rhs));                 \
+    }                                                            \
+                                                                 \
+    static bool decode(const Node& node, type& rhs) {            \
+      if (node.Type() != NodeType::Scalar)                       \
+        return false;                                            \
+      return conversion::DecodeStreamable(node.Scalar(), rhs);   \
+    }                                                            \
   }
 
-#define YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(type) \
-  YAML_DEFINE_CONVERT_STREAMABLE(type, -)
-
-#define YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(type) \
-  YAML_DEFINE_CONVERT_STREAMABLE(type, +)
-
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(int);
+    YAML_DEFINE_CONVERT_STREAMABLE(int);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(short);
+    YAML_DEFINE_CONVERT_STREAMABLE(short);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(long);
+    YAML_DEFINE_CONVERT_STREAMABLE(long);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(long long);
+    YAML_DEFINE_CONVERT_STREAMABLE(long long);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(unsigned);
+    YAML_DEFINE_CONVERT_STREAMABLE(unsigned);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(unsigned short);
+    YAML_DEFINE_CONVERT_STREAMABLE(unsigned short);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(unsigned long);
+    YAML_DEFINE_CONVERT_STREAMABLE(unsigned long);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(unsigned long long);
+    YAML_DEFINE_CONVERT_STREAMABLE(unsigned long long);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(char);
+    YAML_DEFINE_CONVERT_STREAMABLE(char);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(signed char);
+    YAML_DEFINE_CONVERT_STREAMABLE(signed char);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED(unsigned char);
+    YAML_DEFINE_CONVERT_STREAMABLE(unsigned char);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(float);
+    YAML_DEFINE_CONVERT_STREAMABLE(float);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(double);
+    YAML_DEFINE_CONVERT_STREAMABLE(double);
 
-    YAML_DEFINE_CONVERT_STREAMABLE_SIGNED(long double);
+    YAML_DEFINE_CONVERT_STREAMABLE(long double);
 
-#undef YAML_DEFINE_CONVERT_STREAMABLE_SIGNED
-#undef YAML_DEFINE_CONVERT_STREAMABLE_UNSIGNED
 #undef YAML_DEFINE_CONVERT_STREAMABLE
 
 // bool
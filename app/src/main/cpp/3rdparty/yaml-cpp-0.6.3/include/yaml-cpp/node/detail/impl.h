@@ -88,6 +88,18 @@ namespace YAML {
             }
         };
 
+        // Keys which equal exactly the scalar key nodes with the same text, so that they can
+        // be looked up in the index of a large map.
+        template<typename Key>
+        struct indexed_key {
+            static const std::string *get(const Key & /* key */) { return nullptr; }
+        };
+
+        template<>
+        struct indexed_key<std::string> {
+            static const std::string *get(const std::string &key) { return &key; }
+        };
+
         template<typename T>
         inline bool node::equals(const T &rhs, shared_memory_holder pMemory) {
             T lhs;
@@ -119,6 +131,12 @@ namespace YAML {
                     throw BadSubscript(key);
             }
 
+            const std::string *scalarKey = indexed_key<Key>::get(key);
+            if (scalarKey && m_isIndexed) {
+                std::size_t i = find_indexed(*scalarKey);
+                return i < m_map.size() ? m_map[i].second : nullptr;
+            }
+
             for (node_map::const_iterator it = m_map.begin(); it != m_map.end(); ++it) {
                 if (it->first->equals(key, pMemory)) {
                     return it->second;
@@ -147,9 +165,18 @@ namespace YAML {
                     throw BadSubscript(key);
             }
 
-            for (node_map::const_iterator it = m_map.begin(); it != m_map.end(); ++it) {
-                if (it->first->equals(key, pMemory)) {
-                    return *it->second;
+            const std::string *scalarKey = indexed_key<Key>::get(key);
+            if (scalarKey && uses_index()) {
+                if (!m_isIndexed)
+                    build_index();
+                std::size_t i = find_indexed(*scalarKey);
+                if (i < m_map.size())
+                    return *m_map[i].second;
+            } else {
+                for (node_map::const_iterator it = m_map.begin(); it != m_map.end(); ++it) {
+                    if (it->first->equals(key, pMemory)) {
+                        return *it->second;
+                    }
                 }
             }
 
@@ -176,6 +203,7 @@ namespace YAML {
                 for (node_map::iterator iter = m_map.begin(); iter != m_map.end(); ++iter) {
                     if (iter->first->equals(key, pMemory)) {
                         m_map.erase(iter);
+                        reindex();
                         return true;
                     }
                 }
@@ -7,6 +7,7 @@
 #pragma once
 #endif
 
+#include <memory>
 #include <set>
 
 #include "yaml-cpp/dll.h"
@@ -15,22 +16,38 @@
 namespace YAML {
     namespace detail {
         class node;
+
+        class node_chunk;
     }  // namespace detail
 }  // namespace YAML
 
 namespace YAML {
     namespace detail {
+        // An arena of nodes. Nodes are constructed one after the other in chunks of
+        // growing size and are all destroyed together with the last memory sharing
+        // their chunk.
         class YAML_CPP_API memory {
         public:
-            memory() : m_nodes{} {}
+            memory() : m_chunks{}, m_pCurrent(nullptr) {}
+
+            memory(const memory &) = delete;
+
+            memory &operator=(const memory &) = delete;
 
             node &create_node();
 
+            // Takes over every chunk of rhs, leaving rhs empty.
+            void splice(memory &rhs);
+
+            // Shares every chunk of rhs, for when rhs stays in use.
             void merge(const memory &rhs);
 
         private:
-            typedef std::set<shared_node> Nodes;
-            Nodes m_nodes;
+            // A set, as the same memories are merged again and again when nodes are
+            // assigned back and forth between documents.
+            typedef std::set<std::shared_ptr<node_chunk>> Chunks;
+            Chunks m_chunks;
+            node_chunk *m_pCurrent;  // The chunk being filled, one of m_chunks.
         };
 
         class YAML_CPP_API memory_holder {
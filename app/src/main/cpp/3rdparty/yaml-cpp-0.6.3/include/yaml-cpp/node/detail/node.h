@@ -63,9 +63,14 @@ namespace YAML {
                     m_dependencies.insert(&rhs);
             }
 
+            void add_indexing_map(const shared_node_data &pMap) {
+                m_pRef->add_indexing_map(pMap);
+            }
+
             void set_ref(const node &rhs) {
                 if (rhs.is_defined())
                     mark_defined();
+                m_pRef->note_key_change();
                 m_pRef = rhs.m_pRef;
             }
 
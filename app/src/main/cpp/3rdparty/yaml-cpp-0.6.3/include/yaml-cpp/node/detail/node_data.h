@@ -9,7 +9,9 @@
 
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -27,7 +29,7 @@ namespace YAML {
 
 namespace YAML {
     namespace detail {
-        class YAML_CPP_API node_data {
+        class YAML_CPP_API node_data : public std::enable_shared_from_this<node_data> {
         public:
             node_data();
 
@@ -63,6 +65,13 @@ namespace YAML {
 
             EmitterStyle::value style() const { return m_style; }
 
+            // Records that this is a key in the index of `pMap`, see m_index.
+            void add_indexing_map(const shared_node_data &pMap);
+
+            // To be called before a key node stops being this, or this changes, so that
+            // the maps with this as an indexed key drop their index.
+            void note_key_change();
+
             // size/iterator
             std::size_t size() const;
 
@@ -103,6 +112,9 @@ namespace YAML {
         public:
             static const std::string &empty_scalar();
 
+            // Maps with at least this many pairs are looked up by string through an index.
+            static const std::size_t INDEX_THRESHOLD = 16;
+
         private:
             void compute_seq_size() const;
 
@@ -114,6 +126,17 @@ namespace YAML {
 
             void insert_map_pair(node &key, node &value);
 
+            bool uses_index() const { return m_map.size() >= INDEX_THRESHOLD; }
+
+            // The position in m_map of the first pair with a scalar key equal to `key`, or
+            // m_map.size(). Only valid while m_isIndexed.
+            std::size_t find_indexed(const std::string &key) const;
+
+            void build_index();
+
+            // Drops the index after pairs were removed, and rebuilds it if still needed.
+            void reindex();
+
             void convert_to_map(shared_memory_holder pMemory);
 
             void convert_sequence_to_map(shared_memory_holder pMemory);
@@ -141,6 +164,17 @@ namespace YAML {
             typedef std::vector<std::pair<node *, node *>> node_map;
             node_map m_map;
 
+            // Position in m_map of every scalar key, the first one of equal keys, built when a
+            // map reaches INDEX_THRESHOLD pairs and kept up to date by the non-const paths, so
+            // that const lookups only read it. Key nodes can be changed without the maps they
+            // are in knowing, so every indexed key remembers its maps in m_indexingMaps and
+            // drops their index when it changes; until a non-const path rebuilds it, lookups
+            // scan m_map as for small maps.
+            typedef std::unordered_map<std::string, std::size_t> key_index;
+            key_index m_index;
+            bool m_isIndexed;
+            std::vector<std::weak_ptr<node_data>> m_indexingMaps;
+
             typedef std::pair<node *, node *> kv_pair;
             typedef std::list<kv_pair> kv_pairs;
             mutable kv_pairs m_undefinedPairs;
@@ -57,10 +57,7 @@ namespace YAML {
         };
 
         template<typename V>
-        class node_iterator_base
-                : public std::iterator<std::forward_iterator_tag, node_iterator_value<V>,
-                        std::ptrdiff_t, node_iterator_value<V> *,
-                        node_iterator_value<V>> {
+        class node_iterator_base {
         private:
             struct enabler {
             };
@@ -76,6 +73,10 @@ namespace YAML {
             };
 
         public:
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+            using pointer = node_iterator_value<V> *;
+            using reference = node_iterator_value<V>;
             typedef typename node_iterator_type<V>::seq SeqIter;
             typedef typename node_iterator_type<V>::map MapIter;
             typedef node_iterator_value<V> value_type;
@@ -36,7 +36,16 @@ namespace YAML {
 
             void mark_defined() { m_pData->mark_defined(); }
 
-            void set_data(const node_ref &rhs) { m_pData = rhs.m_pData; }
+            void add_indexing_map(const shared_node_data &pMap) {
+                m_pData->add_indexing_map(pMap);
+            }
+
+            void note_key_change() { m_pData->note_key_change(); }
+
+            void set_data(const node_ref &rhs) {
+                m_pData->note_key_change();
+                m_pData = rhs.m_pData;
+            }
 
             void set_mark(const Mark &mark) { m_pData->set_mark(mark); }
 
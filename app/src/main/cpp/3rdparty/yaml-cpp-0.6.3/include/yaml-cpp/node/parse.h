@@ -7,6 +7,7 @@
 #pragma once
 #endif
 
+#include <cstddef>
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -30,6 +31,14 @@ namespace YAML {
  */
     YAML_CPP_API Node Load(const char *input);
 
+/**
+ * Loads {@code length} bytes at {@code input} as a single YAML document. The
+ * bytes are read in place, so they need not be copied nor NUL-terminated.
+ *
+ * @throws {@link ParserException} if it is malformed.
+ */
+    YAML_CPP_API Node Load(const char *input, std::size_t length);
+
 /**
  * Loads the input stream as a single YAML document.
  *
@@ -59,6 +68,14 @@ namespace YAML {
  */
     YAML_CPP_API std::vector<Node> LoadAll(const char *input);
 
+/**
+ * Loads {@code length} bytes at {@code input} as a list of YAML documents,
+ * read in place.
+ *
+ * @throws {@link ParserException} if it is malformed.
+ */
+    YAML_CPP_API std::vector<Node> LoadAll(const char *input, std::size_t length);
+
 /**
  * Loads the input stream as a list of YAML documents.
  *
@@ -7,6 +7,7 @@
 #pragma once
 #endif
 
+#include <cstddef>
 #include <ios>
 #include <memory>
 
@@ -45,6 +46,12 @@ namespace YAML {
          */
         explicit Parser(std::istream &in);
 
+        /**
+         * Constructs a parser reading the given buffer in place, without copying
+         * it. The buffer must live as long as the parser.
+         */
+        Parser(const char *input, std::size_t length);
+
         ~Parser();
 
         /** Evaluates to true if the parser has some valid input to be read. */
@@ -56,6 +63,12 @@ namespace YAML {
          */
         void Load(std::istream &in);
 
+        /**
+         * Resets the parser with the given buffer, read in place. Any existing
+         * state is erased.
+         */
+        void Load(const char *input, std::size_t length);
+
         /**
          * Handles the next document by calling events on the {@code eventHandler}.
          *
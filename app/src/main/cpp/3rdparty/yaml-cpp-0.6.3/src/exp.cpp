@@ -1,5 +1,13 @@
 #include <sstream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YAML_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define YAML_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
 #include "exp.h"
 #include "stream.h"
 #include "yaml-cpp/exceptions.h"  // IWYU pragma: keep
@@ -10,6 +18,98 @@ namespace YAML {
 
 namespace YAML {
     namespace Exp {
+        namespace {
+            constexpr bool In(const char *set, int ch) {
+                return *set != 0 && (*set == ch || In(set + 1, ch));
+            }
+
+            constexpr unsigned short WordClasses(int ch) {
+                return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') ||
+                       ('0' <= ch && ch <= '9') || ch == '-'
+                       ? static_cast<unsigned short>(WORD | URI_CHAR | TAG_CHAR)
+                       : 0;
+            }
+
+            constexpr unsigned short Classify(int ch) {
+                return static_cast<unsigned short>(
+                        (ch == ' ' || ch == '\t' ? BLANK : 0) |
+                        ('0' <= ch && ch <= '9' ? DIGIT : 0) |
+                        (In("0123456789abcdefABCDEF", ch) ? HEX : 0) | WordClasses(ch) |
+                        (In("#;/?:@&=+$,_.!~*'()[]", ch) ? URI_CHAR : 0) |
+                        (In("#;/?:@&=+$_.~*'()", ch) ? TAG_CHAR : 0) |
+                        (In(",[]{}#&*!|>\'\"%@`", ch) ? PLAIN_INDICATOR : 0) |
+                        (In(",?[]{}", ch) ? FLOW_INDICATOR : 0) |
+                        (In("[]{},", ch) ? ANCHOR_STOP : 0) |
+                        (In("?:,]}%@`", ch) ? ANCHOR_END : 0) |
+                        (ch <= '\r' || In("\"#\',:?[\\]{}", ch) ? SCALAR_STOP : 0));
+            }
+        }  // namespace
+
+#define YAML_CLASSIFY_4(ch) \
+    Classify(ch), Classify(ch + 1), Classify(ch + 2), Classify(ch + 3)
+#define YAML_CLASSIFY_16(ch) \
+    YAML_CLASSIFY_4(ch), YAML_CLASSIFY_4(ch + 4), YAML_CLASSIFY_4(ch + 8), \
+    YAML_CLASSIFY_4(ch + 12)
+#define YAML_CLASSIFY_64(ch) \
+    YAML_CLASSIFY_16(ch), YAML_CLASSIFY_16(ch + 16), YAML_CLASSIFY_16(ch + 32), \
+    YAML_CLASSIFY_16(ch + 48)
+
+        // Computed at compile time, so that the table is ready before any static
+        // initializer runs.
+        const unsigned short CharClasses[256] = {
+                YAML_CLASSIFY_64(0), YAML_CLASSIFY_64(64), YAML_CLASSIFY_64(128),
+                YAML_CLASSIFY_64(192)};
+
+#undef YAML_CLASSIFY_64
+#undef YAML_CLASSIFY_16
+#undef YAML_CLASSIFY_4
+
+        const char *FindScalarStop(const char *begin, const char *end) {
+            const char *p = begin;
+            // Stops at the first block with a SCALAR_STOP byte, which the loop below
+            // then finds. Controls are the bytes up to '\r'.
+#if defined(YAML_SCAN_SSE2)
+            for (; end - p >= 16; p += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i stops = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8('\r')), v);
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('#')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('?')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('[')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8(']')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('{')));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+                if (_mm_movemask_epi8(stops) != 0)
+                    break;
+            }
+#elif defined(YAML_SCAN_NEON)
+            for (; end - p >= 16; p += 16) {
+                const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+                uint8x16_t stops = vcleq_u8(v, vdupq_n_u8('\r'));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('"')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('#')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('\'')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8(',')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8(':')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('?')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('[')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('\\')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8(']')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('{')));
+                stops = vorrq_u8(stops, vceqq_u8(v, vdupq_n_u8('}')));
+                if (vmaxvq_u8(stops) != 0)
+                    break;
+            }
+#endif
+            while (p != end && !Is(*p, SCALAR_STOP))
+                ++p;
+            return p;
+        }
+
         unsigned ParseHex(const std::string &str, const Mark &mark) {
             unsigned value = 0;
             for (std::size_t i = 0; i < str.size(); i++) {
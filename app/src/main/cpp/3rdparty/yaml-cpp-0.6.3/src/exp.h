@@ -12,19 +12,17 @@
 
 #include "regex_yaml.h"
 #include "stream.h"
+#include "streamcharsource.h"
 
 namespace YAML {
 ////////////////////////////////////////////////////////////////////////////////
 // Here we store a bunch of expressions for matching different parts of the
-// file.
+// file. The emitter checks strings against the RegEx trees; the scanner uses the
+// table-driven matchers further down, which match the input stream exactly like
+// the trees they replace.
 
     namespace Exp {
 // misc
-        inline const RegEx &Empty() {
-            static const RegEx e;
-            return e;
-        }
-
         inline const RegEx &Space() {
             static const RegEx e = RegEx(' ');
             return e;
@@ -93,66 +91,11 @@ namespace YAML {
 
 // actual tags
 
-        inline const RegEx &DocStart() {
-            static const RegEx e = RegEx("---") + (BlankOrBreak() | RegEx());
-            return e;
-        }
-
-        inline const RegEx &DocEnd() {
-            static const RegEx e = RegEx("...") + (BlankOrBreak() | RegEx());
-            return e;
-        }
-
-        inline const RegEx &DocIndicator() {
-            static const RegEx e = DocStart() | DocEnd();
-            return e;
-        }
-
-        inline const RegEx &BlockEntry() {
-            static const RegEx e = RegEx('-') + (BlankOrBreak() | RegEx());
-            return e;
-        }
-
-        inline const RegEx &Key() {
-            static const RegEx e = RegEx('?') + BlankOrBreak();
-            return e;
-        }
-
-        inline const RegEx &KeyInFlow() {
-            static const RegEx e = RegEx('?') + BlankOrBreak();
-            return e;
-        }
-
-        inline const RegEx &Value() {
-            static const RegEx e = RegEx(':') + (BlankOrBreak() | RegEx());
-            return e;
-        }
-
-        inline const RegEx &ValueInFlow() {
-            static const RegEx e = RegEx(':') + (BlankOrBreak() | RegEx(",}", REGEX_OR));
-            return e;
-        }
-
-        inline const RegEx &ValueInJSONFlow() {
-            static const RegEx e = RegEx(':');
-            return e;
-        }
-
         inline const RegEx Comment() {
             static const RegEx e = RegEx('#');
             return e;
         }
 
-        inline const RegEx &Anchor() {
-            static const RegEx e = !(RegEx("[]{},", REGEX_OR) | BlankOrBreak());
-            return e;
-        }
-
-        inline const RegEx &AnchorEnd() {
-            static const RegEx e = RegEx("?:,]}%@`", REGEX_OR) | BlankOrBreak();
-            return e;
-        }
-
         inline const RegEx &URI() {
             static const RegEx e = Word() | RegEx("#;/?:@&=+$,_.!~*'()[]", REGEX_OR) |
                                    (RegEx('%') + Hex() + Hex());
@@ -197,36 +140,234 @@ namespace YAML {
             return e;
         }
 
-        inline const RegEx &ScanScalarEndInFlow() {
-            static const RegEx e = (EndScalarInFlow() | (BlankOrBreak() + Comment()));
-            return e;
+// character classes
+        enum CHAR_CLASS {
+            BLANK = 1 << 0,            // space, tab
+            DIGIT = 1 << 1,
+            HEX = 1 << 2,
+            WORD = 1 << 3,             // alphanumeric, -
+            URI_CHAR = 1 << 4,         // URI() but for %-escapes
+            TAG_CHAR = 1 << 5,         // Tag() but for %-escapes
+            PLAIN_INDICATOR = 1 << 6,  // cannot start a plain scalar
+            FLOW_INDICATOR = 1 << 7,   // ends a plain scalar in flow
+            ANCHOR_STOP = 1 << 8,      // ends an anchor name, besides blanks and breaks
+            ANCHOR_END = 1 << 9,       // may follow an anchor name
+            SCALAR_STOP = 1 << 10      // may end, escape or break a scalar (and controls)
+        };
+
+        // The classes of every byte. Line breaks take two characters and have none but
+        // SCALAR_STOP.
+        extern const unsigned short CharClasses[256];
+
+        // The first SCALAR_STOP byte in [begin, end), or end. Compares 16 bytes at a time
+        // where SSE2 or AArch64 NEON is available.
+        const char *FindScalarStop(const char *begin, const char *end);
+
+        inline bool Is(char ch, unsigned short classes) {
+            return (CharClasses[static_cast<unsigned char>(ch)] & classes) != 0;
         }
 
-        inline const RegEx &ScanScalarEnd() {
-            static const RegEx e = EndScalar() | (BlankOrBreak() + Comment());
-            return e;
+        // The character `i` ahead of the source, or -1 past the end of the input,
+        // which the stream ends with Stream::eof().
+        inline int CharAt(const StreamCharSource &source, int i) {
+            const StreamCharSource ahead = source + i;
+            return ahead ? static_cast<unsigned char>(ahead[0]) : -1;
         }
 
-        inline const RegEx &EscSingleQuote() {
-            static const RegEx e = RegEx("\'\'");
-            return e;
+        inline bool IsAt(const StreamCharSource &source, int i, unsigned short classes) {
+            int ch = CharAt(source, i);
+            return ch >= 0 && (CharClasses[ch] & classes) != 0;
         }
 
-        inline const RegEx &EscBreak() {
-            static const RegEx e = RegEx('\\') + Break();
-            return e;
+        // Length of the line break `i` ahead, or 0.
+        inline int BreakAt(const StreamCharSource &source, int i) {
+            switch (CharAt(source, i)) {
+                case '\n':
+                    return 1;
+                case '\r':
+                    return CharAt(source, i + 1) == '\n' ? 2 : 0;
+                default:
+                    return 0;
+            }
         }
 
-        inline const RegEx &ChompIndicator() {
-            static const RegEx e = RegEx("+-", REGEX_OR);
-            return e;
+        // Length of the blank or line break `i` ahead, or 0.
+        inline int BlankOrBreakAt(const StreamCharSource &source, int i) {
+            return IsAt(source, i, BLANK) ? 1 : BreakAt(source, i);
         }
 
-        inline const RegEx &Chomp() {
-            static const RegEx e = (ChompIndicator() + Digit()) |
-                                   (Digit() + ChompIndicator()) | ChompIndicator() |
-                                   Digit();
-            return e;
+        // Length of what may follow an indicator `i` ahead: a blank, a line break or the
+        // end of the input (0). -1 for anything else.
+        inline int SeparatorAt(const StreamCharSource &source, int i) {
+            if (int n = BlankOrBreakAt(source, i))
+                return n;
+            return CharAt(source, i) == Stream::eof() ? 0 : -1;
+        }
+
+// stream matchers
+// . Like RegEx::Match, return the number of characters matched, or -1.
+        inline int MatchBreak(const Stream &in) {
+            int n = BreakAt(StreamCharSource(in), 0);
+            return n > 0 ? n : -1;
+        }
+
+        inline bool IsBreak(const Stream &in) { return BreakAt(StreamCharSource(in), 0) > 0; }
+
+        inline bool IsBlank(const Stream &in) { return IsAt(StreamCharSource(in), 0, BLANK); }
+
+        inline bool IsBlankOrBreak(const Stream &in) {
+            return BlankOrBreakAt(StreamCharSource(in), 0) > 0;
+        }
+
+        inline bool IsComment(const Stream &in) {
+            return CharAt(StreamCharSource(in), 0) == '#';
+        }
+
+        // RegEx(): the end of the input.
+        inline int MatchEndOfInput(const Stream &in) {
+            return CharAt(StreamCharSource(in), 0) == Stream::eof() ? 0 : -1;
+        }
+
+        // "---" or "...", followed by a separator.
+        inline int MatchDocIndicator(const Stream &in, char indicator) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != indicator || CharAt(source, 1) != indicator ||
+                CharAt(source, 2) != indicator)
+                return -1;
+            int n = SeparatorAt(source, 3);
+            return n >= 0 ? 3 + n : -1;
+        }
+
+        inline int MatchDocStart(const Stream &in) { return MatchDocIndicator(in, '-'); }
+
+        inline int MatchDocEnd(const Stream &in) { return MatchDocIndicator(in, '.'); }
+
+        inline bool IsDocIndicator(const Stream &in) {
+            return MatchDocStart(in) >= 0 || MatchDocEnd(in) >= 0;
+        }
+
+        inline int MatchBlockEntry(const Stream &in) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != '-')
+                return -1;
+            int n = SeparatorAt(source, 1);
+            return n >= 0 ? 1 + n : -1;
+        }
+
+        // In both block and flow context.
+        inline int MatchKey(const Stream &in) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != '?')
+                return -1;
+            int n = BlankOrBreakAt(source, 1);
+            return n > 0 ? 1 + n : -1;
+        }
+
+        inline int MatchValue(const Stream &in) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != ':')
+                return -1;
+            int n = SeparatorAt(source, 1);
+            return n >= 0 ? 1 + n : -1;
+        }
+
+        inline int MatchValueInFlow(const Stream &in) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != ':')
+                return -1;
+            if (int n = BlankOrBreakAt(source, 1))
+                return 1 + n;
+            int ch = CharAt(source, 1);
+            return ch == ',' || ch == '}' ? 2 : -1;
+        }
+
+        inline int MatchValueInJSONFlow(const Stream &in) {
+            return CharAt(StreamCharSource(in), 0) == ':' ? 1 : -1;
+        }
+
+        inline bool IsAnchor(const Stream &in) {
+            StreamCharSource source(in);
+            return CharAt(source, 0) >= 0 && !IsAt(source, 0, ANCHOR_STOP | BLANK) &&
+                   !BreakAt(source, 0);
+        }
+
+        inline bool IsAnchorEnd(const Stream &in) {
+            StreamCharSource source(in);
+            return IsAt(source, 0, ANCHOR_END | BLANK) || BreakAt(source, 0);
+        }
+
+        // A character of a URI(), or a %-escape.
+        inline int MatchURI(const Stream &in, unsigned short classes = URI_CHAR) {
+            StreamCharSource source(in);
+            if (IsAt(source, 0, classes))
+                return 1;
+            if (CharAt(source, 0) == '%' && IsAt(source, 1, HEX) && IsAt(source, 2, HEX))
+                return 3;
+            return -1;
+        }
+
+        inline int MatchTag(const Stream &in) { return MatchURI(in, TAG_CHAR); }
+
+        inline int MatchWord(const Stream &in) {
+            return IsAt(StreamCharSource(in), 0, WORD) ? 1 : -1;
+        }
+
+        // Plain scalar rules, see PlainScalar() and PlainScalarInFlow().
+        inline bool IsPlainScalarStart(const Stream &in, bool inFlow) {
+            StreamCharSource source(in);
+            int ch = CharAt(source, 0);
+            if (ch < 0 || BlankOrBreakAt(source, 0) || IsAt(source, 0, PLAIN_INDICATOR))
+                return false;
+            if (inFlow)
+                return ch != '?' && !((ch == '-' || ch == ':') && IsAt(source, 1, BLANK));
+            return !((ch == '-' || ch == '?' || ch == ':') && SeparatorAt(source, 1) >= 0);
+        }
+
+        // EndScalar() or EndScalarInFlow(), or a comment after a blank or break.
+        inline int MatchPlainScalarEnd(const Stream &in, bool inFlow) {
+            StreamCharSource source(in);
+            int ch = CharAt(source, 0);
+            if (ch == ':') {
+                int n = SeparatorAt(source, 1);
+                if (n >= 0)
+                    return 1 + n;
+                if (inFlow && (CharAt(source, 1) == ',' || CharAt(source, 1) == ']' ||
+                               CharAt(source, 1) == '}'))
+                    return 2;
+            }
+            if (inFlow && IsAt(source, 0, FLOW_INDICATOR))
+                return 1;
+            int n = BlankOrBreakAt(source, 0);
+            return n > 0 && CharAt(source, n) == '#' ? n + 1 : -1;
+        }
+
+        // A closing quote, but for an escaped '' in single quotes.
+        inline int MatchQuotedScalarEnd(const Stream &in, char quote) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != quote)
+                return -1;
+            return quote == '\'' && CharAt(source, 1) == '\'' ? -1 : 1;
+        }
+
+        inline int MatchEscBreak(const Stream &in) {
+            StreamCharSource source(in);
+            if (CharAt(source, 0) != '\\')
+                return -1;
+            int n = BreakAt(source, 1);
+            return n > 0 ? 1 + n : -1;
+        }
+
+        // Chomping and indentation indicators of a block scalar, in either order.
+        inline int MatchChomp(const Stream &in) {
+            StreamCharSource source(in);
+            int ch = CharAt(source, 0);
+            if (ch == '+' || ch == '-')
+                return IsAt(source, 1, DIGIT) ? 2 : 1;
+            if (IsAt(source, 0, DIGIT)) {
+                ch = CharAt(source, 1);
+                return ch == '+' || ch == '-' ? 2 : 1;
+            }
+            return -1;
         }
 
 // and some functions
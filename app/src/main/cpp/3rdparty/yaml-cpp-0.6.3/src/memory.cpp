@@ -2,25 +2,92 @@
 #include "yaml-cpp/node/detail/node.h"  // IWYU pragma: keep
 #include "yaml-cpp/node/ptr.h"
 
+#include <algorithm>
+#include <new>
+
 namespace YAML {
     namespace detail {
+        // A header followed by room for `capacity` nodes, in a single allocation.
+        class alignas(node) node_chunk {
+        public:
+            static const std::size_t MIN_CAPACITY = 16;
+            static const std::size_t MAX_CAPACITY = 1024;
+
+            static std::shared_ptr<node_chunk> create(std::size_t capacity) {
+                void *block = ::operator new(sizeof(node_chunk) + capacity * sizeof(node));
+                return std::shared_ptr<node_chunk>(new(block) node_chunk(capacity), destroy);
+            }
+
+            std::size_t capacity() const { return m_capacity; }
+
+            bool full() const { return m_size == m_capacity; }
+
+            node &create_node() {
+                node *pNode = new(nodes() + m_size) node;
+                ++m_size;
+                return *pNode;
+            }
+
+        private:
+            explicit node_chunk(std::size_t capacity) : m_capacity(capacity), m_size(0) {}
+
+            ~node_chunk() {
+                for (std::size_t i = m_size; i > 0; --i)
+                    nodes()[i - 1].~node();
+            }
+
+            static void destroy(node_chunk *chunk) {
+                chunk->~node_chunk();
+                ::operator delete(chunk);
+            }
+
+            node *nodes() { return reinterpret_cast<node *>(this + 1); }
+
+            const std::size_t m_capacity;
+            std::size_t m_size;
+        };
+
+        const std::size_t node_chunk::MIN_CAPACITY;
+        const std::size_t node_chunk::MAX_CAPACITY;
 
         void memory_holder::merge(memory_holder &rhs) {
             if (m_pMemory == rhs.m_pMemory)
                 return;
 
-            m_pMemory->merge(*rhs.m_pMemory);
+            // Another holder may still use the memory of rhs, which must then keep its
+            // chunks.
+            if (rhs.m_pMemory.use_count() == 1)
+                m_pMemory->splice(*rhs.m_pMemory);
+            else
+                m_pMemory->merge(*rhs.m_pMemory);
             rhs.m_pMemory = m_pMemory;
         }
 
         node &memory::create_node() {
-            shared_node pNode(new node);
-            m_nodes.insert(pNode);
-            return *pNode;
+            if (!m_pCurrent || m_pCurrent->full()) {
+                std::size_t capacity = !m_pCurrent ? node_chunk::MIN_CAPACITY :
+                                       std::min(2 * m_pCurrent->capacity(),
+                                                node_chunk::MAX_CAPACITY);
+                std::shared_ptr<node_chunk> pChunk = node_chunk::create(capacity);
+                m_chunks.insert(pChunk);
+                m_pCurrent = pChunk.get();
+            }
+            return m_pCurrent->create_node();
+        }
+
+        void memory::splice(memory &rhs) {
+            if (m_chunks.empty()) {
+                m_chunks.swap(rhs.m_chunks);
+                m_pCurrent = rhs.m_pCurrent;
+            } else {
+                m_chunks.insert(rhs.m_chunks.begin(), rhs.m_chunks.end());
+                rhs.m_chunks.clear();
+            }
+            rhs.m_pCurrent = nullptr;
         }
 
         void memory::merge(const memory &rhs) {
-            m_nodes.insert(rhs.m_nodes.begin(), rhs.m_nodes.end());
+            m_chunks.insert(rhs.m_chunks.begin(), rhs.m_chunks.end());
         }
     }
 }
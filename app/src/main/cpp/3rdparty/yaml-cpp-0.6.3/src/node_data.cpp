@@ -28,6 +28,9 @@ namespace YAML {
                   m_sequence{},
                   m_seqSize(0),
                   m_map{},
+                  m_index{},
+                  m_isIndexed(false),
+                  m_indexingMaps{},
                   m_undefinedPairs{} {}
 
         void node_data::mark_defined() {
@@ -36,9 +39,32 @@ namespace YAML {
             m_isDefined = true;
         }
 
+        void node_data::add_indexing_map(const shared_node_data &pMap) {
+            typedef std::vector<std::weak_ptr<node_data>>::iterator map_iterator;
+            for (map_iterator it = m_indexingMaps.begin(); it != m_indexingMaps.end();) {
+                shared_node_data pIndexed = it->lock();
+                if (pIndexed == pMap)
+                    return;
+                if (pIndexed)
+                    ++it;
+                else
+                    it = m_indexingMaps.erase(it);
+            }
+            m_indexingMaps.emplace_back(pMap);
+        }
+
+        void node_data::note_key_change() {
+            for (std::size_t i = 0; i < m_indexingMaps.size(); i++) {
+                if (shared_node_data pMap = m_indexingMaps[i].lock())
+                    pMap->m_isIndexed = false;
+            }
+            m_indexingMaps.clear();
+        }
+
         void node_data::set_mark(const Mark &mark) { m_mark = mark; }
 
         void node_data::set_type(NodeType::value type) {
+            note_key_change();
             if (type == NodeType::Undefined) {
                 m_type = type;
                 m_isDefined = false;
@@ -74,11 +100,13 @@ namespace YAML {
         void node_data::set_style(EmitterStyle::value style) { m_style = style; }
 
         void node_data::set_null() {
+            note_key_change();
             m_isDefined = true;
             m_type = NodeType::Null;
         }
 
         void node_data::set_scalar(const std::string &scalar) {
+            note_key_change();
             m_isDefined = true;
             m_type = NodeType::Scalar;
             m_scalar = scalar;
@@ -254,6 +282,7 @@ namespace YAML {
             for (node_map::iterator it = m_map.begin(); it != m_map.end(); ++it) {
                 if (it->first->is(key)) {
                     m_map.erase(it);
+                    reindex();
                     return true;
                 }
             }
@@ -268,16 +297,52 @@ namespace YAML {
 
         void node_data::reset_map() {
             m_map.clear();
+            m_index.clear();
+            m_isIndexed = false;
             m_undefinedPairs.clear();
         }
 
         void node_data::insert_map_pair(node &key, node &value) {
             m_map.emplace_back(&key, &value);
+            if (m_isIndexed) {
+                key.add_indexing_map(shared_from_this());
+                if (key.type() == NodeType::Scalar)
+                    m_index.emplace(key.scalar(), m_map.size() - 1);
+            } else if (uses_index()) {
+                build_index();
+            }
 
             if (!key.is_defined() || !value.is_defined())
                 m_undefinedPairs.emplace_back(&key, &value);
         }
 
+        std::size_t node_data::find_indexed(const std::string &key) const {
+            assert(m_isIndexed);
+            key_index::const_iterator it = m_index.find(key);
+            return it == m_index.end() ? m_map.size() : it->second;
+        }
+
+        void node_data::build_index() {
+            const shared_node_data pThis = shared_from_this();
+            m_index.clear();
+            m_index.reserve(m_map.size());
+            for (std::size_t i = 0; i < m_map.size(); i++) {
+                node &key = *m_map[i].first;
+                key.add_indexing_map(pThis);
+                if (key.type() == NodeType::Scalar)
+                    m_index.emplace(key.scalar(), i);
+            }
+            m_isIndexed = true;
+        }
+
+        void node_data::reindex() {
+            m_isIndexed = false;
+            if (uses_index())
+                build_index();
+            else
+                m_index.clear();
+        }
+
         void node_data::convert_to_map(shared_memory_holder pMemory) {
             switch (m_type) {
                 case NodeType::Undefined:
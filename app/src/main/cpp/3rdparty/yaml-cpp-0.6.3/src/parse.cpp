@@ -1,7 +1,7 @@
 #include "yaml-cpp/node/parse.h"
 
+#include <cstring>
 #include <fstream>
-#include <sstream>
 
 #include "yaml-cpp/node/node.h"
 #include "yaml-cpp/node/impl.h"
@@ -9,24 +9,46 @@
 #include "nodebuilder.h"
 
 namespace YAML {
+    namespace {
+        Node LoadFirstDocument(Parser &parser) {
+            NodeBuilder builder;
+            if (!parser.HandleNextDocument(builder)) {
+                return Node();
+            }
+
+            return builder.Root();
+        }
+
+        std::vector<Node> LoadAllDocuments(Parser &parser) {
+            std::vector<Node> docs;
+            while (1) {
+                NodeBuilder builder;
+                if (!parser.HandleNextDocument(builder)) {
+                    break;
+                }
+                docs.push_back(builder.Root());
+            }
+
+            return docs;
+        }
+    }
+
     Node Load(const std::string &input) {
-        std::stringstream stream(input);
-        return Load(stream);
+        return Load(input.data(), input.size());
     }
 
     Node Load(const char *input) {
-        std::stringstream stream(input);
-        return Load(stream);
+        return Load(input, std::strlen(input));
+    }
+
+    Node Load(const char *input, std::size_t length) {
+        Parser parser(input, length);
+        return LoadFirstDocument(parser);
     }
 
     Node Load(std::istream &input) {
         Parser parser(input);
-        NodeBuilder builder;
-        if (!parser.HandleNextDocument(builder)) {
-            return Node();
-        }
-
-        return builder.Root();
+        return LoadFirstDocument(parser);
     }
 
     Node LoadFile(const std::string &filename) {
@@ -38,28 +60,21 @@ namespace YAML {
     }
 
     std::vector<Node> LoadAll(const std::string &input) {
-        std::stringstream stream(input);
-        return LoadAll(stream);
+        return LoadAll(input.data(), input.size());
     }
 
     std::vector<Node> LoadAll(const char *input) {
-        std::stringstream stream(input);
-        return LoadAll(stream);
+        return LoadAll(input, std::strlen(input));
     }
 
-    std::vector<Node> LoadAll(std::istream &input) {
-        std::vector<Node> docs;
+    std::vector<Node> LoadAll(const char *input, std::size_t length) {
+        Parser parser(input, length);
+        return LoadAllDocuments(parser);
+    }
 
+    std::vector<Node> LoadAll(std::istream &input) {
         Parser parser(input);
-        while (1) {
-            NodeBuilder builder;
-            if (!parser.HandleNextDocument(builder)) {
-                break;
-            }
-            docs.push_back(builder.Root());
-        }
-
-        return docs;
+        return LoadAllDocuments(parser);
     }
 
     std::vector<Node> LoadAllFromFile(const std::string &filename) {
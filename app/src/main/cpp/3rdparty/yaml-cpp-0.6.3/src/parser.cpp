@@ -15,6 +15,10 @@ namespace YAML {
 
     Parser::Parser(std::istream &in) : Parser() { Load(in); }
 
+    Parser::Parser(const char *input, std::size_t length) : Parser() {
+        Load(input, length);
+    }
+
     Parser::~Parser() {}
 
     Parser::operator bool() const {
@@ -26,6 +30,11 @@ namespace YAML {
         m_pDirectives.reset(new Directives);
     }
 
+    void Parser::Load(const char *input, std::size_t length) {
+        m_pScanner.reset(new Scanner(input, length));
+        m_pDirectives.reset(new Directives);
+    }
+
     bool Parser::HandleNextDocument(EventHandler &eventHandler) {
         if (!m_pScanner.get())
             return false;
@@ -10,6 +10,20 @@ namespace YAML {
     Scanner::Scanner(std::istream &in)
             : INPUT(in),
               m_tokens{},
+              m_scalar{},
+              m_startedStream(false),
+              m_endedStream(false),
+              m_simpleKeyAllowed(false),
+              m_canBeJSONFlow(false),
+              m_simpleKeys{},
+              m_indents{},
+              m_indentRefs{},
+              m_flows{} {}
+
+    Scanner::Scanner(const char *input, std::size_t length)
+            : INPUT(input, length),
+              m_tokens{},
+              m_scalar{},
               m_startedStream(false),
               m_endedStream(false),
               m_simpleKeyAllowed(false),
@@ -108,11 +122,11 @@ namespace YAML {
         }
 
         // document token
-        if (INPUT.column() == 0 && Exp::DocStart().Matches(INPUT)) {
+        if (INPUT.column() == 0 && Exp::MatchDocStart(INPUT) >= 0) {
             return ScanDocStart();
         }
 
-        if (INPUT.column() == 0 && Exp::DocEnd().Matches(INPUT)) {
+        if (INPUT.column() == 0 && Exp::MatchDocEnd(INPUT) >= 0) {
             return ScanDocEnd();
         }
 
@@ -131,15 +145,15 @@ namespace YAML {
         }
 
         // block/map stuff
-        if (Exp::BlockEntry().Matches(INPUT)) {
+        if (Exp::MatchBlockEntry(INPUT) >= 0) {
             return ScanBlockEntry();
         }
 
-        if ((InBlockContext() ? Exp::Key() : Exp::KeyInFlow()).Matches(INPUT)) {
+        if (Exp::MatchKey(INPUT) >= 0) {
             return ScanKey();
         }
 
-        if (GetValueRegex().Matches(INPUT)) {
+        if (MatchValue() >= 0) {
             return ScanValue();
         }
 
@@ -164,8 +178,7 @@ namespace YAML {
         }
 
         // plain scalars
-        if ((InBlockContext() ? Exp::PlainScalar() : Exp::PlainScalarInFlow())
-                .Matches(INPUT)) {
+        if (Exp::IsPlainScalarStart(INPUT, InFlowContext())) {
             return ScanPlainScalar();
         }
 
@@ -177,27 +190,27 @@ namespace YAML {
         while (1) {
             // first eat whitespace
             while (INPUT && IsWhitespaceToBeEaten(INPUT.peek())) {
-                if (InBlockContext() && Exp::Tab().Matches(INPUT)) {
+                if (InBlockContext() && INPUT.peek() == '\t') {
                     m_simpleKeyAllowed = false;
                 }
                 INPUT.eat(1);
             }
 
             // then eat a comment
-            if (Exp::Comment().Matches(INPUT)) {
+            if (Exp::IsComment(INPUT)) {
                 // eat until line break
-                while (INPUT && !Exp::Break().Matches(INPUT)) {
+                while (INPUT && !Exp::IsBreak(INPUT)) {
                     INPUT.eat(1);
                 }
             }
 
             // if it's NOT a line break, then we're done!
-            if (!Exp::Break().Matches(INPUT)) {
+            if (!Exp::IsBreak(INPUT)) {
                 break;
             }
 
             // otherwise, let's eat the line break and keep going
-            int n = Exp::Break().Match(INPUT);
+            int n = Exp::MatchBreak(INPUT);
             INPUT.eat(n);
 
             // oh yeah, and let's get rid of that simple key
@@ -234,12 +247,12 @@ namespace YAML {
         return false;
     }
 
-    const RegEx &Scanner::GetValueRegex() const {
+    int Scanner::MatchValue() const {
         if (InBlockContext()) {
-            return Exp::Value();
+            return Exp::MatchValue(INPUT);
         }
 
-        return m_canBeJSONFlow ? Exp::ValueInJSONFlow() : Exp::ValueInFlow();
+        return m_canBeJSONFlow ? Exp::MatchValueInJSONFlow(INPUT) : Exp::MatchValueInFlow(INPUT);
     }
 
     void Scanner::StartStream() {
@@ -265,8 +278,7 @@ namespace YAML {
     }
 
     Token *Scanner::PushToken(Token::TYPE type) {
-        m_tokens.push(Token(type, INPUT.mark()));
-        return &m_tokens.back();
+        return &m_tokens.push(type, INPUT.mark());
     }
 
     Token::TYPE Scanner::GetStartTokenFor(IndentMarker::INDENT_TYPE type) const {
@@ -327,7 +339,7 @@ namespace YAML {
             }
             if (indent.column == INPUT.column() &&
                 !(indent.type == IndentMarker::SEQ &&
-                  !Exp::BlockEntry().Matches(INPUT))) {
+                  Exp::MatchBlockEntry(INPUT) < 0)) {
                 break;
             }
 
@@ -367,9 +379,9 @@ namespace YAML {
         }
 
         if (indent.type == IndentMarker::SEQ) {
-            m_tokens.push(Token(Token::BLOCK_SEQ_END, INPUT.mark()));
+            m_tokens.push(Token::BLOCK_SEQ_END, INPUT.mark());
         } else if (indent.type == IndentMarker::MAP) {
-            m_tokens.push(Token(Token::BLOCK_MAP_END, INPUT.mark()));
+            m_tokens.push(Token::BLOCK_MAP_END, INPUT.mark());
         }
     }
 
@@ -23,8 +23,6 @@
 namespace YAML {
     class Node;
 
-    class RegEx;
-
 /**
  * A scanner transforms a stream of characters into a stream of tokens.
  */
@@ -32,6 +30,9 @@ namespace YAML {
     public:
         explicit Scanner(std::istream &in);
 
+        /** Scans a contiguous buffer in place; it must outlive the scanner. */
+        Scanner(const char *input, std::size_t length);
+
         ~Scanner();
 
         /** Returns true if there are no more tokens to be read. */
@@ -151,9 +152,9 @@ namespace YAML {
         bool IsWhitespaceToBeEaten(char ch);
 
         /**
-         * Returns the appropriate regex to check if the next token is a value token.
+         * Matches the next token if it is a value token, like Exp::MatchValue().
          */
-        const RegEx &GetValueRegex() const;
+        int MatchValue() const;
 
         struct SimpleKey {
             SimpleKey(const Mark &mark_, std::size_t flowLevel_);
@@ -208,7 +209,11 @@ namespace YAML {
         Stream INPUT;
 
         // the output (tokens)
-        std::queue<Token> m_tokens;
+        TokenQueue m_tokens;
+
+        // the scalar being scanned, swapped into its token so that both buffers get
+        // reused
+        std::string m_scalar;
 
         // state info
         bool m_startedStream, m_endedStream;
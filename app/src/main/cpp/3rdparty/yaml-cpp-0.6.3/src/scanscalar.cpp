@@ -3,11 +3,52 @@
 #include <algorithm>
 
 #include "exp.h"
-#include "regeximpl.h"
 #include "stream.h"
 #include "yaml-cpp/exceptions.h"  // IWYU pragma: keep
 
 namespace YAML {
+    namespace {
+        // Returns the number of characters matched, or -1.
+        int MatchScalarEnd(Stream &INPUT, SCALAR_END end) {
+            switch (end) {
+                case END_OF_INPUT:
+                    return Exp::MatchEndOfInput(INPUT);
+                case END_PLAIN:
+                    return Exp::MatchPlainScalarEnd(INPUT, false);
+                case END_PLAIN_IN_FLOW:
+                    return Exp::MatchPlainScalarEnd(INPUT, true);
+                case END_SINGLE_QUOTE:
+                    return Exp::MatchQuotedScalarEnd(INPUT, '\'');
+                case END_DOUBLE_QUOTE:
+                    return Exp::MatchQuotedScalarEnd(INPUT, '\"');
+            }
+            return -1;
+        }
+
+        // Appends the characters ahead up to the next one which may end, escape or break
+        // the scalar, and returns whether there were any. A blank before a comment is
+        // left to the caller as well.
+        bool AppendRun(Stream &INPUT, std::string &scalar,
+                       std::size_t &lastNonWhitespaceChar) {
+            const char *begin = INPUT.current();
+            const char *end = begin + INPUT.left();
+            const char *stop = Exp::FindScalarStop(begin, end);
+            if (stop != end && *stop == '#' && stop != begin && stop[-1] == ' ')
+                --stop;
+            if (stop == begin)
+                return false;
+
+            scalar.append(begin, stop);
+            const char *last = stop;
+            while (last != begin && last[-1] == ' ')
+                --last;
+            if (last != begin)
+                lastNonWhitespaceChar = scalar.size() - static_cast<std::size_t>(stop - last);
+            INPUT.eatInLine(static_cast<std::size_t>(stop - begin));
+            return true;
+        }
+    }  // namespace
+
 // ScanScalar
 // . This is where the scalar magic happens.
 //
@@ -18,33 +59,29 @@ namespace YAML {
 //
 // . Depending on the parameters given, we store or stop
 //   and different places in the above flow.
-    std::string ScanScalar(Stream &INPUT, ScanScalarParams &params) {
+    void ScanScalar(Stream &INPUT, ScanScalarParams &params, std::string &scalar) {
         bool foundNonEmptyLine = false;
         bool pastOpeningBreak = (params.fold == FOLD_FLOW);
         bool emptyLine = false, moreIndented = false;
         int foldedNewlineCount = 0;
         bool foldedNewlineStartedMoreIndented = false;
         std::size_t lastEscapedChar = std::string::npos;
-        std::string scalar;
+        scalar.clear();
         params.leadingSpaces = false;
 
-        if (!params.end) {
-            params.end = &Exp::Empty();
-        }
-
         while (INPUT) {
             // ********************************
             // Phase #1: scan until line ending
 
             std::size_t lastNonWhitespaceChar = scalar.size();
             bool escapedNewline = false;
-            while (!params.end->Matches(INPUT) && !Exp::Break().Matches(INPUT)) {
+            while (MatchScalarEnd(INPUT, params.end) < 0 && !Exp::IsBreak(INPUT)) {
                 if (!INPUT) {
                     break;
                 }
 
                 // document indicator?
-                if (INPUT.column() == 0 && Exp::DocIndicator().Matches(INPUT)) {
+                if (INPUT.column() == 0 && Exp::IsDocIndicator(INPUT)) {
                     if (params.onDocIndicator == BREAK) {
                         break;
                     } else if (params.onDocIndicator == THROW) {
@@ -55,8 +92,13 @@ namespace YAML {
                 foundNonEmptyLine = true;
                 pastOpeningBreak = true;
 
+                // plain characters? add them all
+                if (AppendRun(INPUT, scalar, lastNonWhitespaceChar)) {
+                    continue;
+                }
+
                 // escaped newline? (only if we're escaping on slash)
-                if (params.escape == '\\' && Exp::EscBreak().Matches(INPUT)) {
+                if (params.escape == '\\' && Exp::MatchEscBreak(INPUT) >= 0) {
                     // eat escape character and get out (but preserve trailing whitespace!)
                     INPUT.get();
                     lastNonWhitespaceChar = scalar.size();
@@ -91,12 +133,12 @@ namespace YAML {
 
             // doc indicator?
             if (params.onDocIndicator == BREAK && INPUT.column() == 0 &&
-                Exp::DocIndicator().Matches(INPUT)) {
+                Exp::IsDocIndicator(INPUT)) {
                 break;
             }
 
             // are we done via character match?
-            int n = params.end->Match(INPUT);
+            int n = MatchScalarEnd(INPUT, params.end);
             if (n >= 0) {
                 if (params.eatEnd) {
                     INPUT.eat(n);
@@ -110,7 +152,7 @@ namespace YAML {
 
             // ********************************
             // Phase #2: eat line ending
-            n = Exp::Break().Match(INPUT);
+            n = Exp::MatchBreak(INPUT);
             INPUT.eat(n);
 
             // ********************************
@@ -120,7 +162,7 @@ namespace YAML {
             while (INPUT.peek() == ' ' &&
                    (INPUT.column() < params.indent ||
                     (params.detectIndent && !foundNonEmptyLine)) &&
-                   !params.end->Matches(INPUT)) {
+                   MatchScalarEnd(INPUT, params.end) < 0) {
                 INPUT.eat(1);
             }
 
@@ -130,7 +172,7 @@ namespace YAML {
             }
 
             // and then the rest of the whitespace
-            while (Exp::Blank().Matches(INPUT)) {
+            while (Exp::IsBlank(INPUT)) {
                 // we check for tabs that masquerade as indentation
                 if (INPUT.peek() == '\t' && INPUT.column() < params.indent &&
                     params.onTabInIndentation == THROW) {
@@ -141,7 +183,7 @@ namespace YAML {
                     break;
                 }
 
-                if (params.end->Matches(INPUT)) {
+                if (MatchScalarEnd(INPUT, params.end) >= 0) {
                     break;
                 }
 
@@ -149,8 +191,8 @@ namespace YAML {
             }
 
             // was this an empty line?
-            bool nextEmptyLine = Exp::Break().Matches(INPUT);
-            bool nextMoreIndented = Exp::Blank().Matches(INPUT);
+            bool nextEmptyLine = Exp::IsBreak(INPUT);
+            bool nextMoreIndented = Exp::IsBlank(INPUT);
             if (params.fold == FOLD_BLOCK && foldedNewlineCount == 0 && nextEmptyLine)
                 foldedNewlineStartedMoreIndented = moreIndented;
 
@@ -246,7 +288,5 @@ namespace YAML {
             default:
                 break;
         }
-
-        return scalar;
     }
 }
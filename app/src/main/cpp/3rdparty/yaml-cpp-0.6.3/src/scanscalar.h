@@ -9,7 +9,6 @@
 
 #include <string>
 
-#include "regex_yaml.h"
 #include "stream.h"
 
 namespace YAML {
@@ -22,10 +21,13 @@ namespace YAML {
     enum FOLD {
         DONT_FOLD, FOLD_BLOCK, FOLD_FLOW
     };
+    enum SCALAR_END {
+        END_OF_INPUT, END_PLAIN, END_PLAIN_IN_FLOW, END_SINGLE_QUOTE, END_DOUBLE_QUOTE
+    };
 
     struct ScanScalarParams {
         ScanScalarParams()
-                : end(nullptr),
+                : end(END_OF_INPUT),
                   eatEnd(false),
                   indent(0),
                   detectIndent(false),
@@ -39,8 +41,7 @@ namespace YAML {
                   leadingSpaces(false) {}
 
         // input:
-        const RegEx *end;   // what condition ends this scalar?
-        // unowned.
+        SCALAR_END end;     // what condition ends this scalar?
         bool eatEnd;        // should we eat that condition when we see it?
         int indent;         // what level of indentation should be eaten and ignored?
         bool detectIndent;  // should we try to autodetect the indent?
@@ -63,7 +64,8 @@ namespace YAML {
         bool leadingSpaces;
     };
 
-    std::string ScanScalar(Stream &INPUT, ScanScalarParams &info);
+    // Scans into 'scalar', whose buffer may be reused.
+    void ScanScalar(Stream &INPUT, ScanScalarParams &info, std::string &scalar);
 }
 
 #endif  // SCANSCALAR_H_62B23520_7C8E_11DE_8A39_0800200C9A66
@@ -1,6 +1,4 @@
 #include "exp.h"
-#include "regex_yaml.h"
-#include "regeximpl.h"
 #include "stream.h"
 #include "yaml-cpp/exceptions.h"  // IWYU pragma: keep
 #include "yaml-cpp/mark.h"
@@ -19,7 +17,7 @@ namespace YAML {
                 return tag;
             }
 
-            int n = Exp::URI().Match(INPUT);
+            int n = Exp::MatchURI(INPUT);
             if (n <= 0)
                 break;
 
@@ -43,7 +41,7 @@ namespace YAML {
 
             int n = 0;
             if (canBeHandle) {
-                n = Exp::Word().Match(INPUT);
+                n = Exp::MatchWord(INPUT);
                 if (n <= 0) {
                     canBeHandle = false;
                     firstNonWordChar = INPUT.mark();
@@ -51,7 +49,7 @@ namespace YAML {
             }
 
             if (!canBeHandle)
-                n = Exp::Tag().Match(INPUT);
+                n = Exp::MatchTag(INPUT);
 
             if (n <= 0)
                 break;
@@ -66,7 +64,7 @@ namespace YAML {
         std::string tag;
 
         while (INPUT) {
-            int n = Exp::Tag().Match(INPUT);
+            int n = Exp::MatchTag(INPUT);
             if (n <= 0)
                 break;
 
@@ -1,8 +1,6 @@
 #include <sstream>
 
 #include "exp.h"
-#include "regex_yaml.h"
-#include "regeximpl.h"
 #include "scanner.h"
 #include "scanscalar.h"
 #include "scantag.h"  // IWYU pragma: keep
@@ -33,28 +31,28 @@ namespace YAML {
         INPUT.eat(1);
 
         // read name
-        while (INPUT && !Exp::BlankOrBreak().Matches(INPUT))
+        while (INPUT && !Exp::IsBlankOrBreak(INPUT))
             token.value += INPUT.get();
 
         // read parameters
         while (1) {
             // first get rid of whitespace
-            while (Exp::Blank().Matches(INPUT))
+            while (Exp::IsBlank(INPUT))
                 INPUT.eat(1);
 
             // break on newline or comment
-            if (!INPUT || Exp::Break().Matches(INPUT) || Exp::Comment().Matches(INPUT))
+            if (!INPUT || Exp::IsBreak(INPUT) || Exp::IsComment(INPUT))
                 break;
 
             // now read parameter
             std::string param;
-            while (INPUT && !Exp::BlankOrBreak().Matches(INPUT))
+            while (INPUT && !Exp::IsBlankOrBreak(INPUT))
                 param += INPUT.get();
 
             token.params.push_back(param);
         }
 
-        m_tokens.push(token);
+        m_tokens.push(std::move(token));
     }
 
 // DocStart
@@ -67,7 +65,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(3);
-        m_tokens.push(Token(Token::DOC_START, mark));
+        m_tokens.push(Token::DOC_START, mark);
     }
 
 // DocEnd
@@ -80,7 +78,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(3);
-        m_tokens.push(Token(Token::DOC_END, mark));
+        m_tokens.push(Token::DOC_END, mark);
     }
 
 // FlowStart
@@ -97,7 +95,7 @@ namespace YAML {
         m_flows.push(flowType);
         Token::TYPE type =
                 (flowType == FLOW_SEQ ? Token::FLOW_SEQ_START : Token::FLOW_MAP_START);
-        m_tokens.push(Token(type, mark));
+        m_tokens.push(type, mark);
     }
 
 // FlowEnd
@@ -108,7 +106,7 @@ namespace YAML {
         // we might have a solo entry in the flow context
         if (InFlowContext()) {
             if (m_flows.top() == FLOW_MAP && VerifySimpleKey())
-                m_tokens.push(Token(Token::VALUE, INPUT.mark()));
+                m_tokens.push(Token::VALUE, INPUT.mark());
             else if (m_flows.top() == FLOW_SEQ)
                 InvalidateSimpleKey();
         }
@@ -127,7 +125,7 @@ namespace YAML {
         m_flows.pop();
 
         Token::TYPE type = (flowType ? Token::FLOW_SEQ_END : Token::FLOW_MAP_END);
-        m_tokens.push(Token(type, mark));
+        m_tokens.push(type, mark);
     }
 
 // FlowEntry
@@ -135,7 +133,7 @@ namespace YAML {
         // we might have a solo entry in the flow context
         if (InFlowContext()) {
             if (m_flows.top() == FLOW_MAP && VerifySimpleKey())
-                m_tokens.push(Token(Token::VALUE, INPUT.mark()));
+                m_tokens.push(Token::VALUE, INPUT.mark());
             else if (m_flows.top() == FLOW_SEQ)
                 InvalidateSimpleKey();
         }
@@ -146,7 +144,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(1);
-        m_tokens.push(Token(Token::FLOW_ENTRY, mark));
+        m_tokens.push(Token::FLOW_ENTRY, mark);
     }
 
 // BlockEntry
@@ -166,7 +164,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(1);
-        m_tokens.push(Token(Token::BLOCK_ENTRY, mark));
+        m_tokens.push(Token::BLOCK_ENTRY, mark);
     }
 
 // Key
@@ -185,7 +183,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(1);
-        m_tokens.push(Token(Token::KEY, mark));
+        m_tokens.push(Token::KEY, mark);
     }
 
 // Value
@@ -214,7 +212,7 @@ namespace YAML {
         // eat
         Mark mark = INPUT.mark();
         INPUT.eat(1);
-        m_tokens.push(Token(Token::VALUE, mark));
+        m_tokens.push(Token::VALUE, mark);
     }
 
 // AnchorOrAlias
@@ -233,7 +231,7 @@ namespace YAML {
         alias = (indicator == Keys::Alias);
 
         // now eat the content
-        while (INPUT && Exp::Anchor().Matches(INPUT))
+        while (INPUT && Exp::IsAnchor(INPUT))
             name += INPUT.get();
 
         // we need to have read SOMETHING!
@@ -242,14 +240,14 @@ namespace YAML {
                                                       : ErrorMsg::ANCHOR_NOT_FOUND);
 
         // and needs to end correctly
-        if (INPUT && !Exp::AnchorEnd().Matches(INPUT))
+        if (INPUT && !Exp::IsAnchorEnd(INPUT))
             throw ParserException(INPUT.mark(), alias ? ErrorMsg::CHAR_IN_ALIAS
                                                       : ErrorMsg::CHAR_IN_ANCHOR);
 
         // and we're done
         Token token(alias ? Token::ALIAS : Token::ANCHOR, mark);
         token.value = name;
-        m_tokens.push(token);
+        m_tokens.push(std::move(token));
     }
 
 // Tag
@@ -288,17 +286,14 @@ namespace YAML {
             }
         }
 
-        m_tokens.push(token);
+        m_tokens.push(std::move(token));
     }
 
 // PlainScalar
     void Scanner::ScanPlainScalar() {
-        std::string scalar;
-
         // set up the scanning parameters
         ScanScalarParams params;
-        params.end =
-                (InFlowContext() ? &Exp::ScanScalarEndInFlow() : &Exp::ScanScalarEnd());
+        params.end = (InFlowContext() ? END_PLAIN_IN_FLOW : END_PLAIN);
         params.eatEnd = false;
         params.indent = (InFlowContext() ? 0 : GetTopIndent() + 1);
         params.fold = FOLD_FLOW;
@@ -312,7 +307,7 @@ namespace YAML {
         InsertPotentialSimpleKey();
 
         Mark mark = INPUT.mark();
-        scalar = ScanScalar(INPUT, params);
+        ScanScalar(INPUT, params, m_scalar);
 
         // can have a simple key only if we ended the scalar by starting a new line
         m_simpleKeyAllowed = params.leadingSpaces;
@@ -322,15 +317,11 @@ namespace YAML {
         // if(Exp::IllegalCharInScalar.Matches(INPUT))
         //	throw ParserException(INPUT.mark(), ErrorMsg::CHAR_IN_SCALAR);
 
-        Token token(Token::PLAIN_SCALAR, mark);
-        token.value = scalar;
-        m_tokens.push(token);
+        m_tokens.push(Token::PLAIN_SCALAR, mark).value.swap(m_scalar);
     }
 
 // QuotedScalar
     void Scanner::ScanQuotedScalar() {
-        std::string scalar;
-
         // peek at single or double quote (don't eat because we need to preserve (for
         // the time being) the input position)
         char quote = INPUT.peek();
@@ -338,8 +329,7 @@ namespace YAML {
 
         // setup the scanning parameters
         ScanScalarParams params;
-        RegEx end = (single ? RegEx(quote) & !Exp::EscSingleQuote() : RegEx(quote));
-        params.end = &end;
+        params.end = (single ? END_SINGLE_QUOTE : END_DOUBLE_QUOTE);
         params.eatEnd = true;
         params.escape = (single ? '\'' : '\\');
         params.indent = 0;
@@ -358,13 +348,11 @@ namespace YAML {
         INPUT.get();
 
         // and scan
-        scalar = ScanScalar(INPUT, params);
+        ScanScalar(INPUT, params, m_scalar);
         m_simpleKeyAllowed = false;
         m_canBeJSONFlow = true;
 
-        Token token(Token::NON_PLAIN_SCALAR, mark);
-        token.value = scalar;
-        m_tokens.push(token);
+        m_tokens.push(Token::NON_PLAIN_SCALAR, mark).value.swap(m_scalar);
     }
 
 // BlockScalarToken
@@ -373,8 +361,6 @@ namespace YAML {
 // of the scalar),
 //   and then we need to figure out what level of indentation we'll be using.
     void Scanner::ScanBlockScalar() {
-        std::string scalar;
-
         ScanScalarParams params;
         params.indent = 1;
         params.detectIndent = true;
@@ -386,14 +372,14 @@ namespace YAML {
 
         // eat chomping/indentation indicators
         params.chomp = CLIP;
-        int n = Exp::Chomp().Match(INPUT);
+        int n = Exp::MatchChomp(INPUT);
         for (int i = 0; i < n; i++) {
             char ch = INPUT.get();
             if (ch == '+')
                 params.chomp = KEEP;
             else if (ch == '-')
                 params.chomp = STRIP;
-            else if (Exp::Digit().Matches(ch)) {
+            else if (Exp::Is(ch, Exp::DIGIT)) {
                 if (ch == '0')
                     throw ParserException(INPUT.mark(), ErrorMsg::ZERO_INDENT_IN_BLOCK);
 
@@ -403,16 +389,16 @@ namespace YAML {
         }
 
         // now eat whitespace
-        while (Exp::Blank().Matches(INPUT))
+        while (Exp::IsBlank(INPUT))
             INPUT.eat(1);
 
         // and comments to the end of the line
-        if (Exp::Comment().Matches(INPUT))
-            while (INPUT && !Exp::Break().Matches(INPUT))
+        if (Exp::IsComment(INPUT))
+            while (INPUT && !Exp::IsBreak(INPUT))
                 INPUT.eat(1);
 
         // if it's not a line break, then we ran into a bad character inline
-        if (INPUT && !Exp::Break().Matches(INPUT))
+        if (INPUT && !Exp::IsBreak(INPUT))
             throw ParserException(INPUT.mark(), ErrorMsg::CHAR_IN_BLOCK);
 
         // set the initial indentation
@@ -423,15 +409,13 @@ namespace YAML {
         params.trimTrailingSpaces = false;
         params.onTabInIndentation = THROW;
 
-        scalar = ScanScalar(INPUT, params);
+        ScanScalar(INPUT, params, m_scalar);
 
         // simple keys always ok after block scalars (since we're gonna start a new
         // line anyways)
         m_simpleKeyAllowed = true;
         m_canBeJSONFlow = false;
 
-        Token token(Token::NON_PLAIN_SCALAR, mark);
-        token.value = scalar;
-        m_tokens.push(token);
+        m_tokens.push(Token::NON_PLAIN_SCALAR, mark).value.swap(m_scalar);
     }
 }  // namespace YAML
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string>
 
 #include "stream.h"
 
@@ -166,7 +167,7 @@ namespace YAML {
                 static_cast<unsigned char>(header | ((ch >> rshift) & mask)));
     }
 
-    inline void QueueUnicodeCodepoint(std::deque<char> &q, unsigned long ch) {
+    inline void QueueUnicodeCodepoint(std::string &q, unsigned long ch) {
         // We are not allowed to queue the Stream::eof() codepoint, so
         // replace it with CP_REPLACEMENT_CHARACTER
         if (static_cast<unsigned long>(Stream::eof()) == ch) {
@@ -190,21 +191,13 @@ namespace YAML {
         }
     }
 
-    Stream::Stream(std::istream &input)
-            : m_input(input),
-              m_mark{},
-              m_charSet{},
-              m_readahead{},
-              m_pPrefetched(new unsigned char[YAML_PREFETCH_SIZE]),
-              m_nPrefetchedAvailable(0),
-              m_nPrefetchedUsed(0) {
+    // Determines (or guesses) the character-set by reading the BOM, if any, and puts
+    // back the bytes which do not belong to it. See the YAML specification for the
+    // determination algorithm.
+    template<typename Input>
+    UtfIntroState ReadUtfIntro(Input &input) {
         typedef std::istream::traits_type char_traits;
 
-        if (!input)
-            return;
-
-        // Determine (or guess) the character-set by reading the BOM, if any.  See
-        // the YAML specification for the determination algorithm.
         char_traits::int_type intro[4];
         int nIntroUsed = 0;
         UtfIntroState state = uis_start;
@@ -223,138 +216,20 @@ namespace YAML {
             }
             state = newState;
         }
-
-        switch (state) {
-            case uis_utf8:
-                m_charSet = utf8;
-                break;
-            case uis_utf16le:
-                m_charSet = utf16le;
-                break;
-            case uis_utf16be:
-                m_charSet = utf16be;
-                break;
-            case uis_utf32le:
-                m_charSet = utf32le;
-                break;
-            case uis_utf32be:
-                m_charSet = utf32be;
-                break;
-            default:
-                m_charSet = utf8;
-                break;
-        }
-
-        ReadAheadTo(0);
-    }
-
-    Stream::~Stream() { delete[] m_pPrefetched; }
-
-    char Stream::peek() const {
-        if (m_readahead.empty()) {
-            return Stream::eof();
-        }
-
-        return m_readahead[0];
-    }
-
-    Stream::operator bool() const {
-        return m_input.good() ||
-               (!m_readahead.empty() && m_readahead[0] != Stream::eof());
-    }
-
-// get
-// . Extracts a character from the stream and updates our position
-    char Stream::get() {
-        char ch = peek();
-        AdvanceCurrent();
-        m_mark.column++;
-
-        if (ch == '\n') {
-            m_mark.column = 0;
-            m_mark.line++;
-        }
-
-        return ch;
-    }
-
-// get
-// . Extracts 'n' characters from the stream and updates our position
-    std::string Stream::get(int n) {
-        std::string ret;
-        ret.reserve(n);
-        for (int i = 0; i < n; i++)
-            ret += get();
-        return ret;
+        return state;
     }
 
-// eat
-// . Eats 'n' characters and updates our position.
-    void Stream::eat(int n) {
-        for (int i = 0; i < n; i++)
-            get();
-    }
-
-    void Stream::AdvanceCurrent() {
-        if (!m_readahead.empty()) {
-            m_readahead.pop_front();
-            m_mark.pos++;
-        }
-
-        ReadAheadTo(0);
-    }
-
-    bool Stream::_ReadAheadTo(size_t i) const {
-        while (m_input.good() && (m_readahead.size() <= i)) {
-            switch (m_charSet) {
-                case utf8:
-                    StreamInUtf8();
-                    break;
-                case utf16le:
-                    StreamInUtf16();
-                    break;
-                case utf16be:
-                    StreamInUtf16();
-                    break;
-                case utf32le:
-                    StreamInUtf32();
-                    break;
-                case utf32be:
-                    StreamInUtf32();
-                    break;
-            }
-        }
-
-        // signal end of stream
-        if (!m_input.good())
-            m_readahead.push_back(Stream::eof());
-
-        return m_readahead.size() > i;
-    }
-
-    void Stream::StreamInUtf8() const {
-        unsigned char b = GetNextByte();
-        if (m_input.good()) {
-            m_readahead.push_back(b);
-        }
-    }
-
-    void Stream::StreamInUtf16() const {
-        unsigned long ch = 0;
-        unsigned char bytes[2];
-        int nBigEnd = (m_charSet == utf16be) ? 0 : 1;
-
-        bytes[0] = GetNextByte();
-        bytes[1] = GetNextByte();
-        if (!m_input.good()) {
-            return;
-        }
-        ch = (static_cast<unsigned long>(bytes[nBigEnd]) << 8) |
-             static_cast<unsigned long>(bytes[1 ^ nBigEnd]);
+    // Decodes the UTF-16 character at 'p', which has at least two bytes left, and
+    // advances past it.
+    inline void DecodeUtf16(const unsigned char *&p, const unsigned char *end, int nBigEnd,
+                            std::string &text) {
+        unsigned long ch = (static_cast<unsigned long>(p[nBigEnd]) << 8) |
+                           static_cast<unsigned long>(p[1 ^ nBigEnd]);
+        p += 2;
 
         if (ch >= 0xDC00 && ch < 0xE000) {
             // Trailing (low) surrogate...ugh, wrong order
-            QueueUnicodeCodepoint(m_readahead, CP_REPLACEMENT_CHARACTER);
+            QueueUnicodeCodepoint(text, CP_REPLACEMENT_CHARACTER);
             return;
         } else if (ch >= 0xD800 && ch < 0xDC00) {
             // ch is a leading (high) surrogate
@@ -363,23 +238,23 @@ namespace YAML {
 
             // Read the trailing (low) surrogate
             for (;;) {
-                bytes[0] = GetNextByte();
-                bytes[1] = GetNextByte();
-                if (!m_input.good()) {
-                    QueueUnicodeCodepoint(m_readahead, CP_REPLACEMENT_CHARACTER);
+                if (end - p < 2) {
+                    p = end;
+                    QueueUnicodeCodepoint(text, CP_REPLACEMENT_CHARACTER);
                     return;
                 }
-                unsigned long chLow = (static_cast<unsigned long>(bytes[nBigEnd]) << 8) |
-                                      static_cast<unsigned long>(bytes[1 ^ nBigEnd]);
+                unsigned long chLow = (static_cast<unsigned long>(p[nBigEnd]) << 8) |
+                                      static_cast<unsigned long>(p[1 ^ nBigEnd]);
+                p += 2;
                 if (chLow < 0xDC00 || chLow >= 0xE000) {
                     // Trouble...not a low surrogate.  Dump a REPLACEMENT CHARACTER into the
                     // stream.
-                    QueueUnicodeCodepoint(m_readahead, CP_REPLACEMENT_CHARACTER);
+                    QueueUnicodeCodepoint(text, CP_REPLACEMENT_CHARACTER);
 
                     // Deal with the next UTF-16 unit
                     if (chLow < 0xD800 || chLow >= 0xE000) {
                         // Easiest case: queue the codepoint and return
-                        QueueUnicodeCodepoint(m_readahead, ch);
+                        QueueUnicodeCodepoint(text, ch);
                         return;
                     } else {
                         // Start the loop over with the new high surrogate
@@ -401,52 +276,162 @@ namespace YAML {
             }
         }
 
-        QueueUnicodeCodepoint(m_readahead, ch);
+        QueueUnicodeCodepoint(text, ch);
     }
 
-    inline char *ReadBuffer(unsigned char *pBuffer) {
-        return reinterpret_cast<char *>(pBuffer);
-    }
+    // The part of std::istream which ReadUtfIntro uses, over a buffer.
+    class BufferIntroInput {
+    public:
+        BufferIntroInput(const unsigned char *begin, const unsigned char *end)
+                : m_pCurrent(begin), m_pEnd(end), m_failed(false) {}
 
-    unsigned char Stream::GetNextByte() const {
-        if (m_nPrefetchedUsed >= m_nPrefetchedAvailable) {
-            std::streambuf *pBuf = m_input.rdbuf();
-            m_nPrefetchedAvailable = static_cast<std::size_t>(
-                    pBuf->sgetn(ReadBuffer(m_pPrefetched), YAML_PREFETCH_SIZE));
-            m_nPrefetchedUsed = 0;
-            if (!m_nPrefetchedAvailable) {
-                m_input.setstate(std::ios_base::eofbit);
+        std::istream::int_type get() {
+            if (m_pCurrent == m_pEnd) {
+                m_failed = true;
+                return std::istream::traits_type::eof();
             }
+            return *m_pCurrent++;
+        }
 
-            if (0 == m_nPrefetchedAvailable) {
-                return 0;
-            }
+        void clear() { m_failed = false; }
+
+        void putback(char) { --m_pCurrent; }
+
+        const unsigned char *current() const { return m_pCurrent; }
+
+        bool failed() const { return m_failed; }
+
+    private:
+        const unsigned char *m_pCurrent;
+        const unsigned char *const m_pEnd;
+        bool m_failed;
+    };
+
+    Stream::Stream(std::istream &input)
+            : m_mark{}, m_charSet{}, m_owned{}, m_pBegin(nullptr), m_pCurrent(nullptr),
+              m_pEnd(nullptr) {
+        if (!input)
+            return;
+
+        std::streambuf *pBuf = input.rdbuf();
+        for (;;) {
+            std::size_t size = m_owned.size();
+            m_owned.resize(size + YAML_PREFETCH_SIZE);
+            std::size_t nRead = static_cast<std::size_t>(pBuf->sgetn(&m_owned[size], YAML_PREFETCH_SIZE));
+            m_owned.resize(size + nRead);
+            if (nRead < YAML_PREFETCH_SIZE)
+                break;
         }
+        input.setstate(std::ios_base::eofbit);
+
+        Open(m_owned.data(), m_owned.size());
+    }
 
-        return m_pPrefetched[m_nPrefetchedUsed++];
+    Stream::Stream(const char *input, std::size_t length)
+            : m_mark{}, m_charSet{}, m_owned{}, m_pBegin(nullptr), m_pCurrent(nullptr),
+              m_pEnd(nullptr) {
+        Open(input, length);
     }
 
-    void Stream::StreamInUtf32() const {
+    void Stream::Open(const char *input, std::size_t length) {
+        const unsigned char *begin = reinterpret_cast<const unsigned char *>(input);
+        const unsigned char *end = begin + length;
+        BufferIntroInput intro(begin, end);
+        DetectCharSet(ReadUtfIntro(intro));
+        begin = intro.current();
+
+        switch (m_charSet) {
+            case utf8:
+                m_pBegin = reinterpret_cast<const char *>(begin);
+                m_pEnd = reinterpret_cast<const char *>(end);
+                break;
+            case utf16le:
+            case utf16be:
+                TranscodeUtf16(begin, end);
+                break;
+            case utf32le:
+            case utf32be:
+                TranscodeUtf32(begin, end);
+                break;
+        }
+        m_pCurrent = m_pBegin;
+    }
+
+    void Stream::DetectCharSet(int introState) {
+        switch (static_cast<UtfIntroState>(introState)) {
+            case uis_utf8:
+                m_charSet = utf8;
+                break;
+            case uis_utf16le:
+                m_charSet = utf16le;
+                break;
+            case uis_utf16be:
+                m_charSet = utf16be;
+                break;
+            case uis_utf32le:
+                m_charSet = utf32le;
+                break;
+            case uis_utf32be:
+                m_charSet = utf32be;
+                break;
+            default:
+                m_charSet = utf8;
+                break;
+        }
+    }
+
+// get
+// . Extracts 'n' characters from the stream and updates our position
+    std::string Stream::get(int n) {
+        std::string ret;
+        ret.reserve(n);
+        for (int i = 0; i < n; i++)
+            ret += get();
+        return ret;
+    }
+
+// eat
+// . Eats 'n' characters and updates our position.
+    void Stream::eat(int n) {
+        for (int i = 0; i < n; i++)
+            get();
+    }
+
+// TranscodeUtf16
+// . Decodes the input into the owned buffer. An odd trailing byte is dropped.
+    void Stream::TranscodeUtf16(const unsigned char *begin, const unsigned char *end) {
+        std::string text;
+        text.reserve(static_cast<std::size_t>(end - begin) / 2 * 3);
+        int nBigEnd = (m_charSet == utf16be) ? 0 : 1;
+
+        while (end - begin >= 2)
+            DecodeUtf16(begin, end, nBigEnd, text);
+
+        m_owned.swap(text);
+        m_pBegin = m_owned.data();
+        m_pEnd = m_pBegin + m_owned.size();
+    }
+
+    void Stream::TranscodeUtf32(const unsigned char *begin, const unsigned char *end) {
         static int indexes[2][4] = {{3, 2, 1, 0},
                                     {0, 1, 2, 3}};
 
-        unsigned long ch = 0;
-        unsigned char bytes[4];
+        std::string text;
+        text.reserve(static_cast<std::size_t>(end - begin));
         int *pIndexes = (m_charSet == utf32be) ? indexes[1] : indexes[0];
 
-        bytes[0] = GetNextByte();
-        bytes[1] = GetNextByte();
-        bytes[2] = GetNextByte();
-        bytes[3] = GetNextByte();
-        if (!m_input.good()) {
-            return;
-        }
+        for (; end - begin >= 4; begin += 4) {
+            unsigned long ch = 0;
+            for (int i = 0; i < 4; ++i) {
+                ch <<= 8;
+                ch |= begin[pIndexes[i]];
+            }
 
-        for (int i = 0; i < 4; ++i) {
-            ch <<= 8;
-            ch |= bytes[pIndexes[i]];
+            QueueUnicodeCodepoint(text, ch);
         }
 
-        QueueUnicodeCodepoint(m_readahead, ch);
+        m_owned.swap(text);
+        m_pBegin = m_owned.data();
+        m_pEnd = m_pBegin + m_owned.size();
     }
 }  // namespace YAML
@@ -9,7 +9,6 @@
 
 #include "yaml-cpp/mark.h"
 #include <cstddef>
-#include <deque>
 #include <ios>
 #include <iostream>
 #include <set>
@@ -22,6 +21,9 @@ namespace YAML {
 
         Stream(std::istream &input);
 
+        // Reads a contiguous buffer in place. The buffer must outlive the stream.
+        Stream(const char *input, std::size_t length);
+
         Stream(const Stream &) = delete;
 
         Stream(Stream &&) = delete;
@@ -30,13 +32,11 @@ namespace YAML {
 
         Stream &operator=(Stream &&) = delete;
 
-        ~Stream();
-
-        operator bool() const;
+        operator bool() const { return m_pCurrent < m_pEnd; }
 
         bool operator!() const { return !static_cast<bool>(*this); }
 
-        char peek() const;
+        char peek() const { return m_pCurrent < m_pEnd ? *m_pCurrent : eof(); }
 
         char get();
 
@@ -56,45 +56,75 @@ namespace YAML {
 
         void ResetColumn() { m_mark.column = 0; }
 
+        // The characters left of the input, for scanning ahead in bulk.
+        const char *current() const { return m_pCurrent; }
+
+        std::size_t left() const { return static_cast<std::size_t>(m_pEnd - m_pCurrent); }
+
+        // Eats 'n' characters within the current line.
+        void eatInLine(std::size_t n) {
+            m_pCurrent += n;
+            m_mark.pos += static_cast<int>(n);
+            m_mark.column += static_cast<int>(n);
+        }
+
     private:
         enum CharacterSet {
             utf8, utf16le, utf16be, utf32le, utf32be
         };
 
-        std::istream &m_input;
+        // The whole input as UTF-8, read at construction: a caller's UTF-8 buffer is
+        // served in place, whereas the contents of an input stream and any UTF-16 or
+        // UTF-32 input are decoded once into an owned buffer. Past the end, the input
+        // reads as eof().
         Mark m_mark;
-
         CharacterSet m_charSet;
-        mutable std::deque<char> m_readahead;
-        unsigned char *const m_pPrefetched;
-        mutable size_t m_nPrefetchedAvailable;
-        mutable size_t m_nPrefetchedUsed;
+        std::string m_owned;
+        const char *m_pBegin;
+        const char *m_pCurrent;
+        const char *m_pEnd;
+
+        void Open(const char *input, std::size_t length);
 
-        void AdvanceCurrent();
+        void DetectCharSet(int introState);
 
         char CharAt(size_t i) const;
 
         bool ReadAheadTo(size_t i) const;
 
-        bool _ReadAheadTo(size_t i) const;
+        // Decode the input into m_owned.
+        void TranscodeUtf16(const unsigned char *begin, const unsigned char *end);
 
-        void StreamInUtf8() const;
-
-        void StreamInUtf16() const;
-
-        void StreamInUtf32() const;
-
-        unsigned char GetNextByte() const;
+        void TranscodeUtf32(const unsigned char *begin, const unsigned char *end);
     };
 
+// get
+// . Extracts a character from the stream and updates our position
+    inline char Stream::get() {
+        char ch = peek();
+        if (m_pCurrent < m_pEnd)
+            ++m_pCurrent;
+        m_mark.pos++;
+        m_mark.column++;
+
+        if (ch == '\n') {
+            m_mark.column = 0;
+            m_mark.line++;
+        }
+
+        return ch;
+    }
+
 // CharAt
-// . Unchecked access
-    inline char Stream::CharAt(size_t i) const { return m_readahead[i]; }
+// . Unchecked access past the current character; eof() at the end of the input
+    inline char Stream::CharAt(size_t i) const {
+        return i < static_cast<size_t>(m_pEnd - m_pCurrent) ? m_pCurrent[i] : eof();
+    }
 
+// ReadAheadTo
+// . Whether the character 'i' ahead is part of the input or the eof() ending it
     inline bool Stream::ReadAheadTo(size_t i) const {
-        if (m_readahead.size() > i)
-            return true;
-        return _ReadAheadTo(i);
+        return i <= static_cast<size_t>(m_pEnd - m_pCurrent);
     }
 }  // namespace YAML
 
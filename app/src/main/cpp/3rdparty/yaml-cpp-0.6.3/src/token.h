@@ -8,8 +8,11 @@
 #endif
 
 #include "yaml-cpp/mark.h"
+#include <cstddef>
+#include <deque>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace YAML {
@@ -67,6 +70,61 @@ namespace YAML {
         std::vector<std::string> params;
         int data;
     };
+
+    // A queue of tokens which reuses the slots of popped tokens, strings included, so
+    // that scanning a long document settles on a few slots and their buffers. Queued
+    // tokens never move: the scanner keeps pointers to them.
+    class TokenQueue {
+    public:
+        TokenQueue() : m_slots{}, m_head(0), m_size(0) {}
+
+        bool empty() const { return m_size == 0; }
+
+        Token &front() { return m_slots[m_head]; }
+
+        const Token &front() const { return m_slots[m_head]; }
+
+        Token &back() { return m_slots[m_head + m_size - 1]; }
+
+        // Queues a token with an empty value and no params.
+        Token &push(Token::TYPE type, const Mark &mark) {
+            if (m_head + m_size == m_slots.size())
+                m_slots.emplace_back(type, mark);
+            Token &token = m_slots[m_head + m_size++];
+            token.status = Token::VALID;
+            token.type = type;
+            token.mark = mark;
+            token.value.clear();
+            token.params.clear();
+            token.data = 0;
+            return token;
+        }
+
+        void push(Token &&token) {
+            push(token.type, token.mark) = std::move(token);
+        }
+
+        void pop() {
+            ++m_head;
+            if (--m_size == 0) {
+                // start over from the first slot, keeping a few spare ones
+                m_head = 0;
+                if (m_slots.size() > MAX_SPARE_SLOTS)
+                    m_slots.erase(m_slots.begin() + MAX_SPARE_SLOTS, m_slots.end());
+            } else if (m_head == MAX_SPARE_SLOTS) {
+                // the queue never ran dry: drop the popped slots
+                for (; m_head > 0; --m_head)
+                    m_slots.pop_front();
+            }
+        }
+
+    private:
+        static const std::size_t MAX_SPARE_SLOTS = 64;
+
+        std::deque<Token> m_slots;  // [m_head, m_head + m_size) are queued
+        std::size_t m_head;
+        std::size_t m_size;
+    };
 }  // namespace YAML
 
 #endif  // TOKEN_H_62B23520_7C8E_11DE_8A39_0800200C9A66
@@ -0,0 +1,168 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include "motion-man.h"
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+// What the producer does with an event when the queue is full.
+enum struct OverflowPolicy : int32_t {
+    // Discard the oldest queued event to make room.
+    DROP_OLDEST = 0,
+    // Keep only the newest direction change aside until there is room again.
+    // Other events still make room by discarding the oldest queued event.
+    COALESCE_DIRECTION_CHANGES,
+    // Wait for the consumer.
+    BLOCK
+};
+
+// Bounded lock-free queue of MotionEvent (Dmitry Vyukov's MPMC design).
+//
+// There is one producer, the sensor loop, and one consumer, the dispatcher thread.
+// The queue is multi-consumer so that the producer may pop the oldest event itself
+// when DROP_OLDEST has to make room.
+template<int Capacity>
+class EventQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        MotionEvent event;
+    };
+
+    Cell cells[Capacity];
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) std::atomic<size_t> dequeuePosition{0};
+
+    // Producer-side state.
+    alignas(64) bool hasCoalescedDirectionChange = false;
+    MotionEvent coalescedDirectionChange;
+    std::atomic<uint64_t> droppedEventCount{0};
+    std::atomic<uint64_t> coalescedEventCount{0};
+
+public:
+    EventQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(const MotionEvent &event) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[position & (Capacity - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) position;
+            if (diff == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1,
+                                                          std::memory_order_relaxed)) {
+                    cell.event = event;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(MotionEvent &event) {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[position & (Capacity - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) (position + 1);
+            if (diff == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1,
+                                                          std::memory_order_relaxed)) {
+                    event = cell.event;
+                    cell.sequence.store(position + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Producer only. Returns false when the queue is full and the policy is BLOCK;
+    // the caller should wake the consumer and retry.
+    bool push(const MotionEvent &event, OverflowPolicy policy) {
+        if (!pushCoalescedDirectionChange()) {
+            if (policy == OverflowPolicy::COALESCE_DIRECTION_CHANGES &&
+                event.type == MotionEventType::DIRECTION_CHANGE) {
+                coalesceDirectionChange(event);
+                return true;
+            }
+            if (policy == OverflowPolicy::BLOCK) {
+                return false;
+            }
+            dropOldest();
+            pushCoalescedDirectionChange();
+        }
+
+        while (!tryPush(event)) {
+            if (policy == OverflowPolicy::COALESCE_DIRECTION_CHANGES &&
+                event.type == MotionEventType::DIRECTION_CHANGE) {
+                coalesceDirectionChange(event);
+                return true;
+            }
+            if (policy == OverflowPolicy::BLOCK) {
+                return false;
+            }
+            dropOldest();
+        }
+        return true;
+    }
+
+    // Producer only. Retries the direction change set aside by COALESCE_DIRECTION_CHANGES.
+    bool pushCoalescedDirectionChange() {
+        if (!hasCoalescedDirectionChange) {
+            return true;
+        }
+        if (tryPush(coalescedDirectionChange)) {
+            hasCoalescedDirectionChange = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Approximate while events are being pushed or popped.
+    size_t size() const {
+        size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+        size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    uint64_t getDroppedEventCount() const {
+        return droppedEventCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getCoalescedEventCount() const {
+        return coalescedEventCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    void coalesceDirectionChange(const MotionEvent &event) {
+        if (hasCoalescedDirectionChange) {
+            coalescedEventCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        coalescedDirectionChange = event;
+        hasCoalescedDirectionChange = true;
+    }
+
+    void dropOldest() {
+        MotionEvent dropped;
+        if (tryPop(dropped)) {
+            droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,182 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+// Always-on recording of the last FLIGHT_RECORDER_SECONDS of the pipeline, so that a
+// missed gesture can be looked at after the fact.
+// Nothing in here may depend on Android or JNI headers.
+//
+// Every raw sample and a summary of every update are kept in two preallocated rings.
+// dump() writes them to a file, decoded and replayed by the host tool
+// `flight-decoder`. File layout, all integers in native (little-endian) byte order:
+//
+//     FlightRecorderHeader
+//     FlightRecord[recordCount]    oldest update first
+//     FlightSample[sampleCount]    the raw samples of those updates, oldest first
+
+#include "motion-types.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+const static int FLIGHT_RECORDER_SECONDS = 30;
+const static int FLIGHT_RECORDER_UPDATES = FLIGHT_RECORDER_SECONDS * UPDATE_RATE_HZ;
+// Room for an average of two samples per update.
+const static int FLIGHT_RECORDER_SAMPLES = 2 * FLIGHT_RECORDER_UPDATES;
+
+const static uint32_t FLIGHT_RECORDER_MAGIC = 0x524c464d; // "MFLR"
+const static uint16_t FLIGHT_RECORDER_VERSION = 1;
+// Samples are stored as multiples of this many m/s², which covers ±128 m/s².
+const static float constexpr FLIGHT_SAMPLE_SCALE = 1.0f / 256;
+
+struct FlightRecorderHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t updateRateHz;
+    uint32_t recordCount;
+    uint32_t sampleCount;
+    float sampleScale;
+};
+
+struct FlightRecord {
+    uint32_t update;       // MotionMan update count.
+    uint8_t sampleCount;   // Raw samples read by this update which were recorded.
+    uint8_t direction;     // Acceleration direction after the update.
+    uint8_t move;          // Direction of the move recognized by this update, STILL if none.
+    uint8_t reserved;
+    int16_t gesture;       // Index of the gesture recognized by this update, -1 if none.
+    uint16_t movePeak;     // Peak acceleration of that move, in sample units.
+};
+
+struct FlightSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+static_assert(sizeof(FlightRecorderHeader) == 20, "FlightRecorderHeader is part of the file format.");
+static_assert(sizeof(FlightRecord) == 12, "FlightRecord is part of the file format.");
+static_assert(sizeof(FlightSample) == 6, "FlightSample is part of the file format.");
+
+inline int16_t quantizeFlightSample(float value) {
+    float units = std::round(value / FLIGHT_SAMPLE_SCALE);
+    return static_cast<int16_t>(units > INT16_MAX ? INT16_MAX : units < INT16_MIN ? INT16_MIN : units);
+}
+
+inline float dequantizeFlightSample(int16_t value) {
+    return value * FLIGHT_SAMPLE_SCALE;
+}
+
+// Written by the thread running MotionMan::update(); dump() may be called from any other
+// thread and retries, seqlock style, until it copies both rings between two updates.
+class FlightRecorder {
+    std::atomic<uint32_t> sequence{0};
+    uint64_t recordCount = 0;
+    uint64_t sampleCount = 0;
+    FlightRecord current = {};
+    FlightRecord records[FLIGHT_RECORDER_UPDATES];
+    FlightSample samples[FLIGHT_RECORDER_SAMPLES];
+
+public:
+    void beginUpdate(uint32_t update) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        current = {update, 0, 0, static_cast<uint8_t>(Direction::STILL), 0, -1, 0};
+    }
+
+    // Samples beyond 255 in a single update are left out of the recording.
+    void recordSample(const AccelerometerReadings &readings) {
+        if (current.sampleCount == UINT8_MAX) {
+            return;
+        }
+        samples[sampleCount % FLIGHT_RECORDER_SAMPLES] = {quantizeFlightSample(readings.x),
+                                                          quantizeFlightSample(readings.y),
+                                                          quantizeFlightSample(readings.z)};
+        ++sampleCount;
+        ++current.sampleCount;
+    }
+
+    void recordMove(Direction direction, float peakAcceleration) {
+        current.move = static_cast<uint8_t>(direction);
+        float peak = std::round(peakAcceleration / FLIGHT_SAMPLE_SCALE);
+        current.movePeak = static_cast<uint16_t>(peak > UINT16_MAX ? UINT16_MAX : peak);
+    }
+
+    void recordGesture(int gestureIndex) {
+        current.gesture = static_cast<int16_t>(gestureIndex);
+    }
+
+    void endUpdate(Direction direction) {
+        current.direction = static_cast<uint8_t>(direction);
+        records[recordCount % FLIGHT_RECORDER_UPDATES] = current;
+        ++recordCount;
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    // Writes the updates whose samples are all still in the recorder. Allocates, but only
+    // on the dumping thread.
+    bool dump(const char *path) const {
+        std::vector<FlightRecord> recordCopy(FLIGHT_RECORDER_UPDATES);
+        std::vector<FlightSample> sampleCopy(FLIGHT_RECORDER_SAMPLES);
+        uint64_t recordTotal, sampleTotal;
+        while (true) {
+            uint32_t seq = sequence.load(std::memory_order_acquire);
+            if (seq & 1) {
+                continue;
+            }
+            recordTotal = recordCount;
+            sampleTotal = sampleCount;
+            std::memcpy(recordCopy.data(), records, sizeof(records));
+            std::memcpy(sampleCopy.data(), samples, sizeof(samples));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+
+        // Keep the newest updates whose samples have not been overwritten.
+        uint64_t availableSamples = std::min<uint64_t>(sampleTotal, FLIGHT_RECORDER_SAMPLES);
+        uint64_t oldestRecord = recordTotal > FLIGHT_RECORDER_UPDATES ?
+                                recordTotal - FLIGHT_RECORDER_UPDATES : 0;
+        uint64_t keptSamples = 0;
+        uint64_t first = recordTotal;
+        while (first > oldestRecord &&
+               keptSamples + recordCopy[(first - 1) % FLIGHT_RECORDER_UPDATES].sampleCount <=
+               availableSamples) {
+            --first;
+            keptSamples += recordCopy[first % FLIGHT_RECORDER_UPDATES].sampleCount;
+        }
+
+        FlightRecorderHeader header = {FLIGHT_RECORDER_MAGIC, FLIGHT_RECORDER_VERSION,
+                                       UPDATE_RATE_HZ, static_cast<uint32_t>(recordTotal - first),
+                                       static_cast<uint32_t>(keptSamples), FLIGHT_SAMPLE_SCALE};
+        FILE *file = std::fopen(path, "wb");
+        if (file == nullptr) {
+            LOG_E("Cannot write flight recorder dump %s.", path);
+            return false;
+        }
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        for (uint64_t i = first; written && i < recordTotal; ++i) {
+            written = std::fwrite(&recordCopy[i % FLIGHT_RECORDER_UPDATES],
+                                  sizeof(FlightRecord), 1, file) == 1;
+        }
+        for (uint64_t i = sampleTotal - keptSamples; written && i < sampleTotal; ++i) {
+            written = std::fwrite(&sampleCopy[i % FLIGHT_RECORDER_SAMPLES],
+                                  sizeof(FlightSample), 1, file) == 1;
+        }
+        written = std::fclose(file) == 0 && written;
+        if (!written) {
+            LOG_E("Cannot write flight recorder dump %s.", path);
+        }
+        return written;
+    }
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,1050 @@
+#ifndef GESTURE_SET_H
+#define GESTURE_SET_H
+
+// Compiled gesture sets.
+//
+// gesture.yml is compiled into a versioned binary image by the host tool
+// `gesture-compiler`. The image holds the gesture names and the tables the matcher
+// runs on, and is used in place: straight from AAsset_getBuffer() on Android or
+// from an mmap()ed file on the host, with no parsing and no copies.
+//
+// Layout, all integers in native (little-endian) byte order:
+//
+//     GestureSetHeader
+//     GestureRecord[gestureCount]
+//     uint16_t matchOrder[gestureCount]     gesture indices, best candidate first
+//     uint8_t  directions[]                 Direction ordinals, newest move first
+//     char     names[]                      NUL-terminated UTF-8
+//
+// Every section starts at a multiple of 4 bytes. Matching settings and detection
+// parameters from gesture.yml are validated and converted to MotionMan units by the
+// compiler, so the matcher only compares them against the move history.
+
+#include "motion-types.h"
+#include <yaml-cpp/eventhandler.h>
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <unordered_set>
+
+const static uint32_t GESTURE_SET_MAGIC = 0x5453474d; // "MGST"
+const static uint16_t GESTURE_SET_VERSION = 4;
+
+struct GestureSetHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t gestureCount;
+    uint32_t size;
+    uint32_t gesturesOffset;
+    uint32_t matchOrderOffset;
+    uint32_t directionsOffset;
+    uint32_t directionsSize;
+    uint32_t namesOffset;
+    uint32_t namesSize;
+    float filterAlpha;           // DetectionParameters, in MotionMan units.
+    float directionThreshold;
+    uint16_t quiescentThreshold;
+    uint16_t maxDuring;
+    uint32_t sourceHash;         // gestureSourceHash() of the gesture.yml compiled, or 0.
+};
+
+struct GestureRecord {
+    uint32_t nameOffset;       // Relative to the names section.
+    uint16_t nameLength;       // Excluding the terminating NUL.
+    uint16_t directionCount;
+    uint32_t directionsOffset; // Relative to the directions section.
+    int32_t priority;
+    uint32_t maxDuration;      // In updates, from the first to the last move. 0 for no limit.
+    uint32_t moveTimeout;      // In updates, between two consecutive moves. 0 for no limit.
+    float minPeakAcceleration; // Every move must have been at least this strong.
+};
+
+static_assert(sizeof(GestureSetHeader) == 52, "GestureSetHeader is part of the file format.");
+static_assert(sizeof(GestureRecord) == 28, "GestureRecord is part of the file format.");
+
+// FNV-1a of gesture.yml, which tells whether a gesture set was compiled from it as it is.
+inline uint32_t gestureSourceHash(const char *source, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(source[i])) * 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t millisecondsToUpdates(int milliseconds) {
+    return static_cast<uint32_t>(((int64_t) milliseconds * UPDATE_RATE_HZ + 999) / 1000);
+}
+
+inline int updatesToMilliseconds(uint32_t updates) {
+    return static_cast<int>((int64_t) updates * 1000 / UPDATE_RATE_HZ);
+}
+
+// The first problem found in gesture.yml, at the position of the offending node.
+struct GestureDefinitionError {
+    YAML::Mark mark;
+    std::string message;
+};
+
+inline bool gestureDefinitionError(GestureDefinitionError &error, const YAML::Mark &mark,
+                                   const std::string &message) {
+    error.mark = mark;
+    error.message = message;
+    return false;
+}
+
+inline void logGestureDefinitionError(const char *sourceName, const GestureDefinitionError &error) {
+    LOG_E("%s:%d:%d: %s", sourceName, error.mark.line + 1, error.mark.column + 1,
+          error.message.c_str());
+}
+
+// A node of gesture.yml as the readers below see it: a scalar, or anything else.
+struct GestureValue {
+    YAML::Mark mark;
+    const std::string *scalar; // Null unless the node is a scalar.
+
+    std::string keyName() const {
+        return scalar != nullptr ? *scalar : std::string();
+    }
+};
+
+inline bool readGestureName(const GestureValue &node, std::string &name,
+                            GestureDefinitionError &error) {
+    if (node.scalar == nullptr || node.scalar->empty()) {
+        return gestureDefinitionError(error, node.mark, "Gesture name must be a non-empty string.");
+    }
+    if (node.scalar->size() > UINT16_MAX) {
+        return gestureDefinitionError(error, node.mark, "Gesture name is too long.");
+    }
+    name = *node.scalar;
+    return true;
+}
+
+inline bool readGesturePath(const GestureValue &node, std::vector<Direction> &directions,
+                            GestureDefinitionError &error) {
+    if (node.scalar == nullptr || node.scalar->empty()) {
+        return gestureDefinitionError(error, node.mark, "Gesture path must be a non-empty string.");
+    }
+    const std::string &path = *node.scalar;
+    // Older moves are overwritten in the move history, so longer paths could never match.
+    if (path.size() >= HISTORY_LENGTH) {
+        return gestureDefinitionError(error, node.mark, "Gesture path must be shorter than " +
+                                                        std::to_string(HISTORY_LENGTH) + " moves.");
+    }
+    for (size_t i = 0; i < path.size(); ++i) {
+        switch (path[i]) {
+            case 'L':
+                directions.push_back(Direction::LEFT);
+                break;
+            case 'R':
+                directions.push_back(Direction::RIGHT);
+                break;
+            case 'U':
+                directions.push_back(Direction::UP);
+                break;
+            case 'D':
+                directions.push_back(Direction::DOWN);
+                break;
+            case 'F':
+                directions.push_back(Direction::FORWARD);
+                break;
+            case 'B':
+                directions.push_back(Direction::BACKWARD);
+                break;
+            default:
+                return gestureDefinitionError(
+                        error, node.mark, "Unknown direction '" + path.substr(i, 1) +
+                                          "' at offset " + std::to_string(i) +
+                                          " of the gesture path, expected one of LRUDFB.");
+        }
+    }
+    return true;
+}
+
+// Reads a number the way YAML::Node::as<T>() does.
+template<typename T>
+inline bool readGestureNumber(const GestureValue &node, const char *key, T min, T max, T &value,
+                              GestureDefinitionError &error) {
+    T number;
+    if (node.scalar == nullptr || !YAML::conversion::DecodeStreamable(*node.scalar, number) ||
+        !(number >= min && number <= max)) {
+        std::ostringstream range;
+        range << key << " must be a number from " << min << " to " << max << ".";
+        return gestureDefinitionError(error, node.mark, range.str());
+    }
+    value = number;
+    return true;
+}
+
+// Reads one entry of the extended form of a gesture definition, a map with the keys
+// documented above parseGestureDefinitions(). Moves only count once they pass the
+// directionThreshold of the file, so no sensitivity may be below it.
+inline bool readGestureMapEntry(const GestureValue &key, const GestureValue &value,
+                                float directionThreshold, Gesture &gesture, bool &hasName,
+                                bool &hasPath, GestureDefinitionError &error) {
+    const std::string keyName = key.keyName();
+    if (keyName == "name") {
+        hasName = true;
+        return readGestureName(value, gesture.name, error);
+    } else if (keyName == "path") {
+        hasPath = true;
+        return readGesturePath(value, gesture.directions, error);
+    } else if (keyName == "priority") {
+        return readGestureNumber(value, "priority", INT16_MIN, INT16_MAX, gesture.priority, error);
+    } else if (keyName == "maxDuration") {
+        return readGestureNumber(value, "maxDuration", 0, 600000, gesture.maxDurationMs, error);
+    } else if (keyName == "moveTimeout") {
+        return readGestureNumber(value, "moveTimeout", 0, 600000, gesture.moveTimeoutMs, error);
+    } else if (keyName == "sensitivity") {
+        return readGestureNumber(value, "sensitivity", directionThreshold, 100.0f,
+                                 gesture.sensitivity, error);
+    }
+    return gestureDefinitionError(error, key.mark, "Unknown gesture key '" + keyName +
+                                                   "', expected name, path, priority, "
+                                                   "maxDuration, moveTimeout or sensitivity.");
+}
+
+inline bool checkGestureMap(const YAML::Mark &mark, bool hasName, bool hasPath,
+                            GestureDefinitionError &error) {
+    if (!hasName || !hasPath) {
+        return gestureDefinitionError(error, mark,
+                                      hasName ? "Gesture has no path." : "Gesture has no name.");
+    }
+    return true;
+}
+
+// The `detection` map of gesture.yml being read, see parseGestureDefinitions().
+struct DetectionMap {
+    DetectionParameters parameters;
+    int quiescentTime = updatesToMilliseconds(parameters.quiescentThreshold);
+    int maxDirectionTime = updatesToMilliseconds(parameters.maxDuring);
+
+    bool readEntry(const GestureValue &key, const GestureValue &value,
+                   GestureDefinitionError &error) {
+        const std::string keyName = key.keyName();
+        if (keyName == "filterAlpha") {
+            return readGestureNumber(value, "filterAlpha", 0.001f, 1.0f, parameters.filterAlpha,
+                                     error);
+        } else if (keyName == "directionThreshold") {
+            return readGestureNumber(value, "directionThreshold", 0.1f, 100.0f,
+                                     parameters.directionThreshold, error);
+        } else if (keyName == "quiescentTime") {
+            return readGestureNumber(value, "quiescentTime", 1,
+                                     updatesToMilliseconds(HISTORY_LENGTH - 1), quiescentTime,
+                                     error);
+        } else if (keyName == "maxDirectionTime") {
+            return readGestureNumber(value, "maxDirectionTime", 1,
+                                     updatesToMilliseconds(UINT16_MAX), maxDirectionTime, error);
+        }
+        return gestureDefinitionError(error, key.mark, "Unknown detection key '" + keyName +
+                                                       "', expected filterAlpha, "
+                                                       "directionThreshold, quiescentTime "
+                                                       "or maxDirectionTime.");
+    }
+
+    // Once every entry has been read.
+    bool finish(const YAML::Mark &mark, GestureDefinitionError &error) {
+        parameters.quiescentThreshold = (int) millisecondsToUpdates(quiescentTime);
+        parameters.maxDuring = (int) millisecondsToUpdates(maxDirectionTime);
+        if (parameters.maxDuring < parameters.quiescentThreshold) {
+            return gestureDefinitionError(
+                    error, mark, "maxDirectionTime must not be shorter than quiescentTime.");
+        }
+        return true;
+    }
+};
+
+// Adds a valid gesture unless its name is taken.
+class GestureList {
+    std::vector<Gesture> &gestures;
+    std::unordered_set<std::string> names;
+
+public:
+    explicit GestureList(std::vector<Gesture> &gestures) : gestures(gestures) {
+        for (const Gesture &gesture : gestures) {
+            names.insert(gesture.name);
+        }
+    }
+
+    bool add(Gesture &&gesture, const YAML::Mark &mark, GestureDefinitionError &error) {
+        if (!names.insert(gesture.name).second) {
+            return gestureDefinitionError(error, mark,
+                                          "Gesture " + gesture.name + " is defined twice.");
+        }
+        gestures.push_back(std::move(gesture));
+        return true;
+    }
+};
+
+inline void logGestureRegistered(const Gesture &gesture) {
+    std::string path;
+    for (Direction direction : gesture.directions) {
+        path += "SLRUDFB"[static_cast<int>(direction)];
+    }
+    LOG_I("Gesture registered: %s [%s]", gesture.name.c_str(), path.c_str());
+}
+
+// Reads gesture.yml from the parser's events, straight into the gestures and detection
+// parameters, without building the document. Problems are kept rather than logged, so
+// that parseGestureDefinitions() can report them in a fixed order.
+class GestureDefinitionReader : public YAML::EventHandler {
+    // What the collections being read are.
+    enum class Context {
+        FILE, DETECTION, GESTURES, GESTURE_MAP, GESTURE_PAIR, SKIP
+    };
+
+    struct Frame {
+        Context context;
+        YAML::Mark mark;
+        int size = 0;           // Nodes read, keys and values alternating in maps.
+        YAML::Mark keyMark;     // The key of the map entry being read.
+        bool keyIsScalar = false;
+        std::string key;
+        YAML::Mark pairMarks[2]; // The [name, path] of a pair.
+        bool pairIsScalar[2] = {false, false};
+        std::string pair[2];
+
+        Frame(Context context, const YAML::Mark &mark) : context(context), mark(mark) {}
+
+        bool atKey() const {
+            return size % 2 == 0;
+        }
+
+        GestureValue keyValue() const {
+            return {keyMark, keyIsScalar ? &key : nullptr};
+        }
+    };
+
+    // An event of the document, kept so that aliases can be read as the nodes they stand for.
+    struct Event {
+        enum class Type {
+            NULL_VALUE, ALIAS, SCALAR, SEQUENCE_START, SEQUENCE_END, MAP_START, MAP_END
+        };
+
+        Type type;
+        YAML::Mark mark;
+        YAML::anchor_t anchor; // Of the node an alias stands for.
+        std::string scalar;
+    };
+
+    std::vector<Frame> frames;
+    GestureList gestureList;
+    Gesture gesture;  // Of the GESTURE_MAP being read.
+    bool hasName = false;
+    bool hasPath = false;
+    bool hasGestureMap = false;
+    float directionThreshold; // Of the detection map once read, see readGestureMapEntry().
+
+    // The events from the first anchored node on; none can be aliased before it.
+    std::vector<Event> events;
+    std::vector<size_t> anchoredEvents; // The first event of each anchored node, by anchor.
+    bool replaying = false;
+
+public:
+    bool isFileMap = false;
+    bool hasGestureSequence = false;
+    bool hasDetection = false;
+    bool hasGestures = false;
+    DetectionMap detectionMap;
+    bool detectionFailed = false;
+    GestureDefinitionError detectionError;
+    bool hasUnknownKey = false;
+    GestureDefinitionError unknownKeyError;
+    bool gestureFailed = false;
+    GestureDefinitionError gestureError;
+    // Whether gesture maps were read before a detection map which changed directionThreshold.
+    bool readGestureMapEarly = false;
+
+    GestureDefinitionReader(std::vector<Gesture> &gestures, float directionThreshold)
+            : gestureList(gestures), directionThreshold(directionThreshold) {}
+
+    void OnDocumentStart(const YAML::Mark &) override {}
+
+    void OnDocumentEnd() override {}
+
+    void OnNull(const YAML::Mark &mark, YAML::anchor_t anchor) override {
+        record(Event::Type::NULL_VALUE, mark, anchor);
+        leaf(mark, nullptr);
+    }
+
+    // Reads the events of the aliased node again, as a YAML::Node would see the same node
+    // twice. Nodes in collections which are skipped are not looked into, so that nested
+    // aliases cannot multiply the work.
+    void OnAlias(const YAML::Mark &mark, YAML::anchor_t anchor) override {
+        if (!replaying && !events.empty()) {
+            events.push_back({Event::Type::ALIAS, mark, anchor, std::string()});
+        }
+        if (!frames.empty() && frames.back().context == Context::SKIP) {
+            leaf(mark, nullptr);
+            return;
+        }
+        size_t first = anchoredEvents[anchor];
+        size_t last = lastEventOf(first);
+        if (last == events.size()) {
+            // Within the node it stands for, which has not ended yet.
+            leaf(events[first].mark, nullptr);
+            return;
+        }
+        bool wasReplaying = replaying;
+        replaying = true;
+        for (size_t i = first; i <= last; ++i) {
+            replay(events[i]);
+        }
+        replaying = wasReplaying;
+    }
+
+    void OnScalar(const YAML::Mark &mark, const std::string &, YAML::anchor_t anchor,
+                  const std::string &value) override {
+        record(Event::Type::SCALAR, mark, anchor, &value);
+        leaf(mark, &value);
+    }
+
+    void OnSequenceStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t anchor,
+                         YAML::EmitterStyle::value) override {
+        record(Event::Type::SEQUENCE_START, mark, anchor);
+        frames.emplace_back(child(mark, false, true), mark);
+    }
+
+    void OnSequenceEnd() override {
+        record(Event::Type::SEQUENCE_END, YAML::Mark(), YAML::NullAnchor);
+        end();
+    }
+
+    void OnMapStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t anchor,
+                    YAML::EmitterStyle::value) override {
+        record(Event::Type::MAP_START, mark, anchor);
+        frames.emplace_back(child(mark, true, false), mark);
+    }
+
+    void OnMapEnd() override {
+        record(Event::Type::MAP_END, YAML::Mark(), YAML::NullAnchor);
+        end();
+    }
+
+private:
+    void record(Event::Type type, const YAML::Mark &mark, YAML::anchor_t anchor,
+                const std::string *scalar = nullptr) {
+        if (replaying || (events.empty() && anchor == YAML::NullAnchor)) {
+            return;
+        }
+        if (anchor != YAML::NullAnchor) {
+            if (anchoredEvents.size() <= anchor) {
+                anchoredEvents.resize(anchor + 1);
+            }
+            anchoredEvents[anchor] = events.size();
+        }
+        events.push_back({type, mark, YAML::NullAnchor, scalar ? *scalar : std::string()});
+    }
+
+    // The last event of the node starting with events[first], or events.size() if it has
+    // not ended yet.
+    size_t lastEventOf(size_t first) const {
+        int depth = 0;
+        for (size_t i = first; i < events.size(); ++i) {
+            switch (events[i].type) {
+                case Event::Type::SEQUENCE_START:
+                case Event::Type::MAP_START:
+                    ++depth;
+                    break;
+                case Event::Type::SEQUENCE_END:
+                case Event::Type::MAP_END:
+                    --depth;
+                    break;
+                default:
+                    break;
+            }
+            if (depth == 0) {
+                return i;
+            }
+        }
+        return events.size();
+    }
+
+    void replay(const Event &event) {
+        switch (event.type) {
+            case Event::Type::NULL_VALUE:
+                OnNull(event.mark, YAML::NullAnchor);
+                break;
+            case Event::Type::ALIAS:
+                OnAlias(event.mark, event.anchor);
+                break;
+            case Event::Type::SCALAR:
+                OnScalar(event.mark, std::string(), YAML::NullAnchor, event.scalar);
+                break;
+            case Event::Type::SEQUENCE_START:
+                OnSequenceStart(event.mark, std::string(), YAML::NullAnchor,
+                                YAML::EmitterStyle::Default);
+                break;
+            case Event::Type::SEQUENCE_END:
+                OnSequenceEnd();
+                break;
+            case Event::Type::MAP_START:
+                OnMapStart(event.mark, std::string(), YAML::NullAnchor,
+                           YAML::EmitterStyle::Default);
+                break;
+            case Event::Type::MAP_END:
+                OnMapEnd();
+                break;
+        }
+    }
+
+    void leaf(const YAML::Mark &mark, const std::string *scalar) {
+        if (frames.empty()) {
+            return;
+        }
+        Frame &parent = frames.back();
+        GestureValue value = {mark, scalar};
+        switch (parent.context) {
+            case Context::FILE:
+                if (parent.atKey()) {
+                    readKey(parent, value);
+                } else {
+                    readFileEntry(parent, value, false, false);
+                }
+                break;
+            case Context::DETECTION:
+            case Context::GESTURE_MAP:
+                if (parent.atKey()) {
+                    readKey(parent, value);
+                } else {
+                    readEntry(parent, value);
+                }
+                break;
+            case Context::GESTURES:
+                failGesture(mark, "A gesture must be a [name, path] pair or a map.");
+                break;
+            case Context::GESTURE_PAIR:
+                if (parent.size < 2) {
+                    parent.pairMarks[parent.size] = mark;
+                    parent.pairIsScalar[parent.size] = scalar != nullptr;
+                    if (scalar != nullptr) {
+                        parent.pair[parent.size] = *scalar;
+                    }
+                }
+                break;
+            case Context::SKIP:
+                break;
+        }
+        ++parent.size;
+    }
+
+    // What a collection starting at `mark` is, reading whatever it means for its parent.
+    Context child(const YAML::Mark &mark, bool isMap, bool isSequence) {
+        if (frames.empty()) {
+            isFileMap = isMap;
+            hasGestureSequence = isSequence;
+            return isMap ? Context::FILE : Context::GESTURES;
+        }
+        Frame &parent = frames.back();
+        GestureValue value = {mark, nullptr};
+        switch (parent.context) {
+            case Context::FILE:
+                if (parent.atKey()) {
+                    readKey(parent, value);
+                    return Context::SKIP;
+                }
+                return readFileEntry(parent, value, isMap, isSequence);
+            case Context::DETECTION:
+            case Context::GESTURE_MAP:
+                if (parent.atKey()) {
+                    readKey(parent, value);
+                } else {
+                    readEntry(parent, value);
+                }
+                return Context::SKIP;
+            case Context::GESTURES:
+                if (gestureFailed) {
+                    return Context::SKIP;
+                }
+                if (isMap) {
+                    gesture = Gesture();
+                    hasName = false;
+                    hasPath = false;
+                    hasGestureMap = true;
+                    return Context::GESTURE_MAP;
+                }
+                return Context::GESTURE_PAIR;
+            case Context::GESTURE_PAIR:
+                if (parent.size < 2) {
+                    parent.pairMarks[parent.size] = mark;
+                    parent.pairIsScalar[parent.size] = false;
+                }
+                return Context::SKIP;
+            case Context::SKIP:
+                return Context::SKIP;
+        }
+        return Context::SKIP;
+    }
+
+    void end() {
+        Frame frame = std::move(frames.back());
+        frames.pop_back();
+        switch (frame.context) {
+            case Context::DETECTION:
+                detectionFailed = detectionFailed || !detectionMap.finish(frame.mark, detectionError);
+                if (!detectionFailed &&
+                    detectionMap.parameters.directionThreshold != directionThreshold) {
+                    readGestureMapEarly = hasGestureMap;
+                    directionThreshold = detectionMap.parameters.directionThreshold;
+                }
+                break;
+            case Context::GESTURE_MAP:
+                if (!gestureFailed &&
+                    (!checkGestureMap(frame.mark, hasName, hasPath, gestureError) ||
+                     !gestureList.add(std::move(gesture), frame.mark, gestureError))) {
+                    gestureFailed = true;
+                }
+                break;
+            case Context::GESTURE_PAIR:
+                if (gestureFailed) {
+                    break;
+                }
+                if (frame.size != 2) {
+                    failGesture(frame.mark, "A gesture must be a [name, path] pair or a map.");
+                    break;
+                }
+                {
+                    Gesture pairGesture;
+                    GestureValue name = {frame.pairMarks[0], frame.pairIsScalar[0] ? &frame.pair[0]
+                                                                                   : nullptr};
+                    GestureValue path = {frame.pairMarks[1], frame.pairIsScalar[1] ? &frame.pair[1]
+                                                                                   : nullptr};
+                    gestureFailed = !readGestureName(name, pairGesture.name, gestureError) ||
+                                    !readGesturePath(path, pairGesture.directions, gestureError) ||
+                                    !gestureList.add(std::move(pairGesture), frame.mark,
+                                                     gestureError);
+                }
+                break;
+            default:
+                break;
+        }
+        if (!frames.empty()) {
+            ++frames.back().size;
+        }
+    }
+
+    static void readKey(Frame &frame, const GestureValue &key) {
+        frame.keyMark = key.mark;
+        frame.keyIsScalar = key.scalar != nullptr;
+        if (key.scalar != nullptr) {
+            frame.key = *key.scalar;
+        }
+    }
+
+    // Like file["detection"] and file["gestures"], only the first of each counts.
+    Context readFileEntry(const Frame &file, const GestureValue &value, bool isMap,
+                          bool isSequence) {
+        const std::string keyName = file.keyValue().keyName();
+        if (keyName == "detection") {
+            if (hasDetection) {
+                return Context::SKIP;
+            }
+            hasDetection = true;
+            if (isMap) {
+                return Context::DETECTION;
+            }
+            detectionFailed = true;
+            gestureDefinitionError(detectionError, value.mark, "detection must be a map.");
+        } else if (keyName == "gestures") {
+            if (!hasGestures) {
+                hasGestures = true;
+                hasGestureSequence = isSequence;
+                return isSequence ? Context::GESTURES : Context::SKIP;
+            }
+        } else if (!hasUnknownKey) {
+            hasUnknownKey = true;
+            gestureDefinitionError(unknownKeyError, file.keyMark, "Unknown key '" + keyName +
+                                                                  "', expected detection or gestures.");
+        }
+        return Context::SKIP;
+    }
+
+    void readEntry(const Frame &map, const GestureValue &value) {
+        if (map.context == Context::DETECTION) {
+            detectionFailed = detectionFailed ||
+                              !detectionMap.readEntry(map.keyValue(), value, detectionError);
+        } else if (!gestureFailed) {
+            gestureFailed = !readGestureMapEntry(map.keyValue(), value, directionThreshold,
+                                                 gesture, hasName, hasPath, gestureError);
+        }
+    }
+
+    void failGesture(const YAML::Mark &mark, const char *message) {
+        if (!gestureFailed) {
+            gestureFailed = true;
+            gestureDefinitionError(gestureError, mark, message);
+        }
+    }
+};
+
+// Reads gesture.yml, a sequence of gestures. A gesture is either a `[name, path]` pair
+// such as `[数字4, DRUDD]`, or a map which may also tune how it is matched:
+//
+//     - name: 数字4
+//       path: DRUDD
+//       priority: 1         # Higher priorities are matched first. Defaults to 0.
+//       maxDuration: 3000   # Milliseconds from the first to the last move. Unlimited if 0.
+//       moveTimeout: 1200   # Milliseconds between two consecutive moves. Unlimited if 0.
+//       sensitivity: 3.5    # Acceleration (m/s²) every move must peak at, from
+//                           # directionThreshold, the default, up.
+//
+// The file may instead be a map of that sequence and of the parameters which turn samples
+// into moves, each defaulting to its constant in motion-types.h:
+//
+//     detection:
+//       filterAlpha: 0.1         # SENSOR_FILTER_ALPHA
+//       directionThreshold: 2.0  # DIRECTION_THRESHOLD, in m/s²
+//       quiescentTime: 160       # QUIESCENT_THRESHOLD, in milliseconds
+//       maxDirectionTime: 250    # AccelerationDirectionData::MAX_DURING, in milliseconds
+//     gestures:
+//       - [数字1, DD]
+//
+// Everything is validated here, once; errors are reported with their line and column and
+// leave the gestures defined before the malformed one in `gestures`. `detection` is left
+// alone unless the file has a valid detection map.
+//
+// The gestures are read from the parser's events by a GestureDefinitionReader, with no
+// YAML::Node in between; aliases read as the nodes they stand for.
+inline bool parseGestureDefinitions(const char *source, size_t length, const char *sourceName,
+                                    std::vector<Gesture> &gestures,
+                                    DetectionParameters *detection = nullptr) {
+    size_t first = gestures.size();
+    // A detection map after the gestures is only read after their sensitivities, which
+    // are then read again against its directionThreshold.
+    float directionThreshold = DetectionParameters().directionThreshold;
+    std::unique_ptr<GestureDefinitionReader> pass;
+    do {
+        gestures.resize(first);
+        pass.reset(new GestureDefinitionReader(gestures, directionThreshold));
+        try {
+            YAML::Parser parser(source, length); // Read in place, no copy.
+            parser.HandleNextDocument(*pass);
+        } catch (YAML::ParserException &e) {
+            gestures.resize(first);
+            LOG_E("%s:%d:%d: %s", sourceName, e.mark.line + 1, e.mark.column + 1,
+                  e.msg.c_str());
+            return false;
+        }
+        directionThreshold = pass->detectionMap.parameters.directionThreshold;
+    } while (pass->readGestureMapEarly);
+    const GestureDefinitionReader &reader = *pass;
+
+    // Problems of the detection map first, then unknown keys, then the gestures, wherever
+    // they are in the file.
+    if (reader.isFileMap) {
+        if (reader.detectionFailed || reader.hasUnknownKey) {
+            gestures.resize(first);
+            logGestureDefinitionError(sourceName, reader.detectionFailed ? reader.detectionError
+                                                                         : reader.unknownKeyError);
+            return false;
+        }
+        if (reader.hasDetection && detection != nullptr) {
+            *detection = reader.detectionMap.parameters;
+        }
+    }
+    if (!reader.hasGestureSequence) {
+        gestures.resize(first);
+        LOG_E("Bad gesture definitions file format: %s.", sourceName);
+        return false;
+    }
+    for (size_t i = first; i < gestures.size(); ++i) {
+        logGestureRegistered(gestures[i]);
+    }
+    if (reader.gestureFailed) {
+        logGestureDefinitionError(sourceName, reader.gestureError);
+        return false;
+    }
+    return true;
+}
+
+class GestureSet {
+    std::vector<uint8_t> storage; // Empty while viewing memory owned by someone else.
+
+    const GestureSetHeader *header = nullptr;
+    const GestureRecord *records = nullptr;
+    const uint16_t *matchOrder = nullptr;
+    const uint8_t *directions = nullptr;
+    const char *names = nullptr;
+
+    static size_t align4(size_t offset) {
+        return (offset + 3) & ~static_cast<size_t>(3);
+    }
+
+    template<typename T>
+    static void put(std::vector<uint8_t> &image, size_t offset, const T &value) {
+        std::memcpy(image.data() + offset, &value, sizeof(T));
+    }
+
+public:
+    GestureSet() = default;
+
+    GestureSet(const GestureSet &) = delete;
+
+    GestureSet &operator=(const GestureSet &) = delete;
+
+    // Serializes gestures into a gesture set image. Empty if they do not fit the format.
+    // `sourceHash` is the gestureSourceHash() of the gesture.yml they were read from, if any.
+    static std::vector<uint8_t> compile(const std::vector<Gesture> &gestures,
+                                        const DetectionParameters &detection = {},
+                                        uint32_t sourceHash = 0) {
+        size_t gestureCount = gestures.size();
+        if (gestureCount > UINT16_MAX) {
+            LOG_E("Too many gestures for a gesture set: %zu.", gestureCount);
+            return {};
+        }
+        size_t directionsSize = 0;
+        size_t namesSize = 0;
+        for (size_t i = 0; i < gestureCount; ++i) {
+            const Gesture &gesture = gestures[i];
+            if (gesture.name.size() > UINT16_MAX || gesture.directions.size() > UINT16_MAX) {
+                LOG_E("Gesture #%zu too long for a gesture set.", i);
+                return {};
+            }
+            directionsSize += gesture.directions.size();
+            namesSize += gesture.name.size() + 1;
+        }
+        if (detection.quiescentThreshold < 0 || detection.quiescentThreshold > UINT16_MAX ||
+            detection.maxDuring < 0 || detection.maxDuring > UINT16_MAX) {
+            LOG_E("Detection parameters out of range for a gesture set.");
+            return {};
+        }
+        size_t gesturesOffset = align4(sizeof(GestureSetHeader));
+        size_t matchOrderOffset = align4(gesturesOffset + gestureCount * sizeof(GestureRecord));
+        size_t directionsOffset = align4(matchOrderOffset + gestureCount * sizeof(uint16_t));
+        size_t namesOffset = align4(directionsOffset + directionsSize);
+        size_t imageSize = align4(namesOffset + namesSize);
+        // Every offset is below the end of the image, so they all fit once that does.
+        if (imageSize > UINT32_MAX) {
+            LOG_E("Gestures too large for a gesture set: %zu bytes.", imageSize);
+            return {};
+        }
+
+        GestureSetHeader header = {};
+        header.magic = GESTURE_SET_MAGIC;
+        header.version = GESTURE_SET_VERSION;
+        header.gestureCount = static_cast<uint16_t>(gestureCount);
+        header.gesturesOffset = static_cast<uint32_t>(gesturesOffset);
+        header.matchOrderOffset = static_cast<uint32_t>(matchOrderOffset);
+        header.directionsOffset = static_cast<uint32_t>(directionsOffset);
+        header.directionsSize = static_cast<uint32_t>(directionsSize);
+        header.namesOffset = static_cast<uint32_t>(namesOffset);
+        header.namesSize = static_cast<uint32_t>(namesSize);
+        header.size = static_cast<uint32_t>(imageSize);
+        header.filterAlpha = detection.filterAlpha;
+        header.directionThreshold = detection.directionThreshold;
+        header.quiescentThreshold = static_cast<uint16_t>(detection.quiescentThreshold);
+        header.maxDuring = static_cast<uint16_t>(detection.maxDuring);
+        header.sourceHash = sourceHash;
+
+        std::vector<uint8_t> image(imageSize, 0);
+        put(image, 0, header);
+
+        size_t nextDirection = 0;
+        size_t nextName = 0;
+        for (size_t i = 0; i < gestureCount; ++i) {
+            const Gesture &gesture = gestures[i];
+            GestureRecord record = {
+                    static_cast<uint32_t>(nextName),
+                    static_cast<uint16_t>(gesture.name.size()),
+                    static_cast<uint16_t>(gesture.directions.size()),
+                    static_cast<uint32_t>(nextDirection),
+                    gesture.priority,
+                    millisecondsToUpdates(gesture.maxDurationMs),
+                    millisecondsToUpdates(gesture.moveTimeoutMs),
+                    gesture.sensitivity
+            };
+            put(image, gesturesOffset + i * sizeof(GestureRecord), record);
+
+            // Stored newest first, the order in which the matcher walks the move history.
+            for (auto it = gesture.directions.rbegin(); it != gesture.directions.rend(); ++it) {
+                image[directionsOffset + nextDirection++] = static_cast<uint8_t>(*it);
+            }
+            std::memcpy(image.data() + namesOffset + nextName,
+                        gesture.name.c_str(), gesture.name.size() + 1);
+            nextName += gesture.name.size() + 1;
+        }
+
+        // The matching gesture with the highest priority wins, then the longest one, then
+        // the one whose name sorts last.
+        std::vector<uint16_t> order(gestureCount);
+        for (size_t i = 0; i < gestureCount; ++i) {
+            order[i] = static_cast<uint16_t>(i);
+        }
+        std::sort(order.begin(), order.end(), [&gestures](uint16_t a, uint16_t b) {
+            if (gestures[a].priority != gestures[b].priority) {
+                return gestures[a].priority > gestures[b].priority;
+            }
+            size_t aCount = gestures[a].directions.size();
+            size_t bCount = gestures[b].directions.size();
+            if (aCount != bCount) {
+                return aCount > bCount;
+            }
+            int byName = gestures[a].name.compare(gestures[b].name);
+            return byName != 0 ? byName > 0 : a < b;
+        });
+        for (size_t rank = 0; rank < gestureCount; ++rank) {
+            put(image, matchOrderOffset + rank * sizeof(uint16_t), order[rank]);
+        }
+
+        return image;
+    }
+
+    // The sourceHash an image was compiled with, or 0 if it is not a gesture set of this
+    // version. Only looks at the header, for deciding whether to use the image at all.
+    static uint32_t getSourceHash(const void *image, size_t size) {
+        GestureSetHeader candidate;
+        if (size < sizeof(GestureSetHeader)) {
+            return 0;
+        }
+        std::memcpy(&candidate, image, sizeof(GestureSetHeader));
+        if (candidate.magic != GESTURE_SET_MAGIC || candidate.version != GESTURE_SET_VERSION) {
+            return 0;
+        }
+        return candidate.sourceHash;
+    }
+
+    // Uses an image in place. The memory must stay valid for as long as the set is used.
+    bool view(const void *image, size_t size, const char *sourceName) {
+        clear();
+
+        auto bytes = static_cast<const uint8_t *>(image);
+        if (reinterpret_cast<uintptr_t>(bytes) % alignof(GestureSetHeader) != 0) {
+            LOG_E("Misaligned gesture set: %s.", sourceName);
+            return false;
+        }
+        if (size < sizeof(GestureSetHeader)) {
+            LOG_E("Truncated gesture set: %s.", sourceName);
+            return false;
+        }
+
+        auto candidate = reinterpret_cast<const GestureSetHeader *>(bytes);
+        if (candidate->magic != GESTURE_SET_MAGIC) {
+            LOG_E("Not a gesture set: %s.", sourceName);
+            return false;
+        }
+        if (candidate->version != GESTURE_SET_VERSION) {
+            LOG_E("Unsupported gesture set version %d: %s.", candidate->version, sourceName);
+            return false;
+        }
+
+        size_t count = candidate->gestureCount;
+        bool valid = candidate->size <= size &&
+                     candidate->gesturesOffset % 4 == 0 &&
+                     candidate->matchOrderOffset % 2 == 0 &&
+                     candidate->gesturesOffset + count * sizeof(GestureRecord) <= candidate->size &&
+                     candidate->matchOrderOffset + count * sizeof(uint16_t) <= candidate->size &&
+                     candidate->directionsOffset + (size_t) candidate->directionsSize <= candidate->size &&
+                     candidate->namesOffset + (size_t) candidate->namesSize <= candidate->size &&
+                     candidate->filterAlpha > 0.0f && candidate->filterAlpha <= 1.0f &&
+                     candidate->directionThreshold > 0.0f &&
+                     candidate->quiescentThreshold > 0 &&
+                     candidate->maxDuring >= candidate->quiescentThreshold;
+        if (!valid) {
+            LOG_E("Corrupted gesture set: %s.", sourceName);
+            return false;
+        }
+
+        auto candidateRecords = reinterpret_cast<const GestureRecord *>(
+                bytes + candidate->gesturesOffset);
+        auto candidateMatchOrder = reinterpret_cast<const uint16_t *>(
+                bytes + candidate->matchOrderOffset);
+        const uint8_t *candidateDirections = bytes + candidate->directionsOffset;
+        auto candidateNames = reinterpret_cast<const char *>(bytes + candidate->namesOffset);
+        for (size_t i = 0; i < count; ++i) {
+            const GestureRecord &record = candidateRecords[i];
+            bool recordValid =
+                    candidateMatchOrder[i] < count &&
+                    record.directionCount > 0 &&
+                    record.directionCount < HISTORY_LENGTH &&
+                    record.minPeakAcceleration >= 0.0f &&
+                    record.directionsOffset + (size_t) record.directionCount <= candidate->directionsSize &&
+                    record.nameOffset + (size_t) record.nameLength < candidate->namesSize &&
+                    candidateNames[record.nameOffset + record.nameLength] == '\0';
+            for (size_t d = 0; recordValid && d < record.directionCount; ++d) {
+                uint8_t direction = candidateDirections[record.directionsOffset + d];
+                recordValid = direction > static_cast<uint8_t>(Direction::STILL) &&
+                              direction < DIRECTION_COUNT;
+            }
+            if (!recordValid) {
+                LOG_E("Corrupted gesture #%zu in gesture set: %s.", i, sourceName);
+                return false;
+            }
+        }
+
+        header = candidate;
+        records = candidateRecords;
+        matchOrder = candidateMatchOrder;
+        directions = candidateDirections;
+        names = candidateNames;
+        return true;
+    }
+
+    // Compiles gestures into an image owned by this set. Leaves the set empty if they
+    // cannot be compiled.
+    bool assign(const std::vector<Gesture> &gestures, const DetectionParameters &detection = {}) {
+        std::vector<uint8_t> image = compile(gestures, detection);
+        if (image.empty() || !view(image.data(), image.size(), "<compiled>")) {
+            clear();
+            return false;
+        }
+        storage = std::move(image); // Moving keeps the heap buffer, so the view stays valid.
+        return true;
+    }
+
+    void clear() {
+        header = nullptr;
+        records = nullptr;
+        matchOrder = nullptr;
+        directions = nullptr;
+        names = nullptr;
+        storage.clear();
+    }
+
+    int size() const {
+        return header != nullptr ? header->gestureCount : 0;
+    }
+
+    // The defaults while nothing is loaded.
+    DetectionParameters getDetectionParameters() const {
+        DetectionParameters detection;
+        if (header != nullptr) {
+            detection.filterAlpha = header->filterAlpha;
+            detection.directionThreshold = header->directionThreshold;
+            detection.quiescentThreshold = header->quiescentThreshold;
+            detection.maxDuring = header->maxDuring;
+        }
+        return detection;
+    }
+
+    std::string_view getName(int gestureIndex) const {
+        const GestureRecord &record = records[gestureIndex];
+        return std::string_view(names + record.nameOffset, record.nameLength);
+    }
+
+    // NUL-terminated, suitable for JNI and printf.
+    const char *getNameCString(int gestureIndex) const {
+        return names + records[gestureIndex].nameOffset;
+    }
+
+    int getDirectionCount(int gestureIndex) const {
+        return records[gestureIndex].directionCount;
+    }
+
+    // Everything the matcher needs to know about a gesture.
+    const GestureRecord &getRecord(int gestureIndex) const {
+        return records[gestureIndex];
+    }
+
+    // Direction ordinals of a gesture, last move first.
+    const uint8_t *getDirectionsNewestFirst(int gestureIndex) const {
+        return directions + records[gestureIndex].directionsOffset;
+    }
+
+    // The gesture to try at a given rank; the first one that matches is the best match.
+    int getMatchOrder(int rank) const {
+        return matchOrder[rank];
+    }
+};
+
+#endif // GESTURE_SET_H
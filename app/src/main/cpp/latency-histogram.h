@@ -0,0 +1,156 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// Always-on latency histograms of the recognition pipeline.
+// Nothing in here may depend on Android or JNI headers.
+
+#include "motion-types.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size log-linear histogram of durations in nanoseconds.
+//
+// Values below 2^SUB_BUCKET_BITS nanoseconds are counted exactly. Above that, every
+// power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets, which bounds the
+// error of a reported percentile to 1 / 2^SUB_BUCKET_BITS of the value. Durations of
+// 2^MAX_MAGNITUDE nanoseconds (about 18 minutes) and more land in the last bucket.
+//
+// There is one writer, the sensor loop. Recording is a couple of relaxed atomic
+// increments; readers on other threads may see a snapshot which is off by the samples
+// recorded while they read, never a torn one.
+class LatencyHistogram {
+public:
+    const static int SUB_BUCKET_BITS = 4;
+    const static int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    const static int MAX_MAGNITUDE = 40;
+    const static int BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+private:
+    std::atomic<uint64_t> counts[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> totalCount{0};
+    std::atomic<uint64_t> maxValue{0};
+
+    static int bucketOf(uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<int>(value);
+        }
+        int magnitude = 63 - __builtin_clzll(value);
+        if (magnitude >= MAX_MAGNITUDE) {
+            return BUCKET_COUNT - 1;
+        }
+        int shift = magnitude - SUB_BUCKET_BITS;
+        int subBucket = static_cast<int>(value >> shift) - SUB_BUCKET_COUNT;
+        return (shift + 1) * SUB_BUCKET_COUNT + subBucket;
+    }
+
+    // The largest value counted in a bucket.
+    static uint64_t highestValueOf(int bucket) {
+        if (bucket < SUB_BUCKET_COUNT) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int shift = bucket / SUB_BUCKET_COUNT - 1;
+        uint64_t subBucket = static_cast<uint64_t>(bucket % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT);
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t nanoseconds) {
+        counts[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        totalCount.fetch_add(1, std::memory_order_relaxed);
+        if (nanoseconds > maxValue.load(std::memory_order_relaxed)) {
+            maxValue.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t getCount() const {
+        return totalCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getMax() const {
+        return maxValue.load(std::memory_order_relaxed);
+    }
+
+    // The smallest duration which at least `percentile` percent of the samples do not
+    // exceed, rounded up to its bucket. 0 when nothing was recorded.
+    uint64_t getPercentile(double percentile) const {
+        uint64_t count = getCount();
+        if (count == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            seen += counts[bucket].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint64_t value = highestValueOf(bucket);
+                uint64_t max = getMax();
+                return value < max ? value : max;
+            }
+        }
+        return getMax();
+    }
+};
+
+// Stages of MotionMan::update(), each with its own histogram.
+enum struct PipelineStage : int32_t {
+    READ = 0,
+    MOVEMENT,
+    GESTURE
+};
+
+const static int constexpr PIPELINE_STAGE_COUNT = static_cast<int>(PipelineStage::GESTURE) + 1;
+
+constexpr const char *PIPELINE_STAGE_NAMES[PIPELINE_STAGE_COUNT] = {
+        "read", "movement", "gesture"
+};
+
+// Values reported for every stage, in this order. Keep in sync with MotionLib.java.
+struct LatencySummary {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+const static int LATENCY_SUMMARY_FIELD_COUNT = 5;
+
+class PipelineLatencies {
+    LatencyHistogram histograms[PIPELINE_STAGE_COUNT];
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void record(PipelineStage stage, Clock::time_point start, Clock::time_point stop) {
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
+        histograms[static_cast<int>(stage)].record(static_cast<uint64_t>(nanoseconds.count()));
+    }
+
+    const LatencyHistogram &get(PipelineStage stage) const {
+        return histograms[static_cast<int>(stage)];
+    }
+
+    LatencySummary summarize(PipelineStage stage) const {
+        const LatencyHistogram &histogram = get(stage);
+        return {histogram.getCount(), histogram.getPercentile(50), histogram.getPercentile(99),
+                histogram.getPercentile(99.9), histogram.getMax()};
+    }
+
+    // Logs one line per stage.
+    void dump() const {
+        for (int stage = 0; stage < PIPELINE_STAGE_COUNT; ++stage) {
+            LatencySummary summary = summarize(static_cast<PipelineStage>(stage));
+            LOG_I("%-8s n=%llu p50=%lluns p99=%lluns p999=%lluns max=%lluns",
+                  PIPELINE_STAGE_NAMES[stage], (unsigned long long) summary.count,
+                  (unsigned long long) summary.p50, (unsigned long long) summary.p99,
+                  (unsigned long long) summary.p999, (unsigned long long) summary.max);
+        }
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
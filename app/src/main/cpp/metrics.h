@@ -0,0 +1,89 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// Counters and gauges of one recognizer, for telemetry.
+// Nothing in here may depend on Android or JNI headers.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Keep in sync with the METRIC_* constants of MotionLib.java; new metrics go last.
+enum struct Metric : int32_t {
+    // Pipeline, counted by MotionMan.
+    UPDATES = 0,
+    SAMPLES,
+    DIRECTION_CHANGES,
+    MOVES,
+    GESTURES,
+    // Events of unsubscribed types, in MotionEventType order.
+    DIRECTION_CHANGES_SUPPRESSED,
+    MOVES_SUPPRESSED,
+    GESTURES_SUPPRESSED,
+    // Delivery to Java, counted by motion-lib.
+    SENSOR_CALLBACKS,
+    EVENTS_POSTED,
+    EVENTS_DROPPED,
+    EVENTS_COALESCED,
+    EVENT_BATCHES,
+    EVENTS_DISPATCHED,
+    HANDLER_EXCEPTIONS,
+    // Gauges.
+    EVENT_BACKLOG,
+    EVENT_BACKLOG_MAX,
+    GESTURES_LOADED
+};
+
+const static int constexpr METRIC_COUNT = static_cast<int>(Metric::GESTURES_LOADED) + 1;
+
+constexpr const char *METRIC_NAMES[METRIC_COUNT] = {
+        "updates", "samples", "direction_changes", "moves", "gestures",
+        "direction_changes_suppressed", "moves_suppressed", "gestures_suppressed",
+        "sensor_callbacks", "events_posted", "events_dropped", "events_coalesced",
+        "event_batches", "events_dispatched", "handler_exceptions",
+        "event_backlog", "event_backlog_max", "gestures_loaded"
+};
+
+// Relaxed atomics: every metric may be updated and read from any thread, without
+// ordering against anything else. A snapshot is not atomic as a whole.
+class Metrics {
+    std::atomic<int64_t> values[METRIC_COUNT] = {};
+
+public:
+    void add(Metric metric, int64_t delta = 1) {
+        values[static_cast<int>(metric)].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    void set(Metric metric, int64_t value) {
+        values[static_cast<int>(metric)].store(value, std::memory_order_relaxed);
+    }
+
+    // For gauges with a single writer.
+    void setMax(Metric metric, int64_t value) {
+        if (value > get(metric)) {
+            set(metric, value);
+        }
+    }
+
+    int64_t get(Metric metric) const {
+        return values[static_cast<int>(metric)].load(std::memory_order_relaxed);
+    }
+
+    // Copies up to `count` metrics in Metric order and returns how many there are.
+    int snapshot(int64_t *out, int count) const {
+        for (int i = 0; i < count && i < METRIC_COUNT; ++i) {
+            out[i] = values[i].load(std::memory_order_relaxed);
+        }
+        return METRIC_COUNT;
+    }
+
+    // One `name value` line per metric.
+    void dump(FILE *file) const {
+        for (int i = 0; i < METRIC_COUNT; ++i) {
+            std::fprintf(file, "%s %lld\n", METRIC_NAMES[i],
+                         (long long) values[i].load(std::memory_order_relaxed));
+        }
+    }
+};
+
+#endif // METRICS_H
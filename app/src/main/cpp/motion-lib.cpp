@@ -1,50 +1,215 @@
 #include "motion-lib.h"
 #include <jni.h>
+#include <mutex>
+#include <condition_variable>
 
 
-class MotionMan {
-    JNIEnv *jniEnv;
-    jobject jLib;
-    jmethodID jMethodIdHandleDirectionChange;
-    jmethodID jMethodIdHandleMovementDetected;
-    jmethodID jMethodIdHandleGestureDetected;
+// Feeds the samples queued on an ASensorEventQueue to MotionMan.
+class SensorEventQueueSource : public AccelerometerSource {
+    ASensorEventQueue *eventQueue;
 
-    ASensorManager *sensorManager;
-    const ASensor *accelerometer;
-    ALooper *looper;
-    ASensorEventQueue *accelerometerEventQueue;
-    std::vector<Gesture> registeredGestures;
+public:
+    explicit SensorEventQueueSource(ASensorEventQueue *eventQueue) : eventQueue(eventQueue) {}
 
-    AccelerometerReadings accelerometerReadings[HISTORY_LENGTH];
-    AccelerometerReadings accelerometerReadingsFilter = {0, 0, 0};
-    int nextAccelerometerReadingsIndex = 1;
+    bool nextReadings(AccelerometerReadings &readings) override {
+        ASensorEvent event;
+        if (ASensorEventQueue_getEvents(eventQueue, &event, 1) > 0) {
+            readings = {event.acceleration.x, event.acceleration.y, event.acceleration.z};
+            return true;
+        }
+        return false;
+    }
+};
 
+// Delivers events to Java in batches on a thread of its own, so that slow handlers never
+// hold up the sensor loop. post() and endFrame() are called from the sensor loop only.
+class EventDispatcher {
+    JavaVM *javaVM;
+    jobject jLib;
+    jmethodID jMethodIdHandleEventBatch;
+    Metrics *metrics;
 
-    AccelerationDirectionData accelerationDirectionData[HISTORY_LENGTH] = {
-            {Direction::STILL, AccelerationDirectionData::MAX_DURING, true}
-    };
-    int nextAccelerationDirectionDataIndex = 1;
+    EventQueue<EVENT_QUEUE_CAPACITY> queue;
+    std::atomic<OverflowPolicy> overflowPolicy{OverflowPolicy::DROP_OLDEST};
+
+    // Owned by the dispatcher thread, read by Java during handleEventBatch().
+    MotionEvent eventBatch[EVENT_BATCH_CAPACITY];
 
-    int recognizedMoveDirectionCount = 0;
-    MoveDirectionData moveDirectionData[HISTORY_LENGTH] = {{Direction::STILL, true}};
-    int nextMoveDirectionDataIndex = 1;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool dispatchRequested = false;
+    bool stopRequested = false;
 
-    int recognizedGestureCount = 0;
-    std::string lastRecognizedGestureName = "静止";
+    int undispatchedEventCount = 0;
+    int delayedFrames = 0;
+    bool hasUndispatchedGesture = false;
 
 public:
-    inline int prevIndex(int index) {
-        return (index - 1 + HISTORY_LENGTH) % HISTORY_LENGTH;
+    void start(JNIEnv *env, jobject jLib, jmethodID jMethodIdHandleEventBatch, Metrics &metrics) {
+        env->GetJavaVM(&javaVM);
+        this->jLib = jLib;
+        this->jMethodIdHandleEventBatch = jMethodIdHandleEventBatch;
+        this->metrics = &metrics;
+        thread = std::thread(&EventDispatcher::run, this);
     }
 
-    inline int nextIndex(int index) {
-        return (index + 1) % HISTORY_LENGTH;
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopRequested = true;
+        }
+        wakeUp.notify_one();
+        thread.join();
+    }
+
+    MotionEvent *getEventBatch() {
+        return eventBatch;
+    }
+
+    size_t getEventBatchSize() {
+        return sizeof(eventBatch);
+    }
+
+    void setOverflowPolicy(OverflowPolicy policy) {
+        overflowPolicy.store(policy, std::memory_order_relaxed);
     }
 
-    inline void registerGesture(const std::string &name, const std::vector<Direction> &directions) {
-        registeredGestures.push_back({name, directions});
+    void post(const MotionEvent &event) {
+        OverflowPolicy policy = overflowPolicy.load(std::memory_order_relaxed);
+        while (!queue.push(event, policy)) {
+            requestDispatch();
+            std::this_thread::yield();
+        }
+
+        ++undispatchedEventCount;
+        hasUndispatchedGesture |= event.type == MotionEventType::GESTURE_DETECTED;
+        metrics->add(Metric::EVENTS_POSTED);
+    }
+
+    // Gestures are delivered right after the frame they were recognized in, other
+    // events may wait up to EVENT_BATCH_MAX_DELAY_FRAMES to share a single JNI call.
+    void endFrame() {
+        queue.pushCoalescedDirectionChange();
+        updateQueueMetrics();
+        if (undispatchedEventCount == 0) {
+            return;
+        }
+        if (hasUndispatchedGesture ||
+            undispatchedEventCount >= EVENT_BATCH_CAPACITY ||
+            ++delayedFrames >= EVENT_BATCH_MAX_DELAY_FRAMES) {
+            requestDispatch();
+        }
+    }
+
+private:
+    void updateQueueMetrics() {
+        auto backlog = static_cast<int64_t>(queue.size());
+        metrics->set(Metric::EVENT_BACKLOG, backlog);
+        metrics->setMax(Metric::EVENT_BACKLOG_MAX, backlog);
+        metrics->set(Metric::EVENTS_DROPPED, static_cast<int64_t>(queue.getDroppedEventCount()));
+        metrics->set(Metric::EVENTS_COALESCED,
+                     static_cast<int64_t>(queue.getCoalescedEventCount()));
+    }
+
+    void requestDispatch() {
+        undispatchedEventCount = 0;
+        delayedFrames = 0;
+        hasUndispatchedGesture = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            dispatchRequested = true;
+        }
+        wakeUp.notify_one();
+    }
+
+    void run() {
+        JNIEnv *env;
+        JavaVMAttachArgs attachArgs = {JNI_VERSION_1_6, "MotionLibDispatcher", NULL};
+        javaVM->AttachCurrentThread(&env, &attachArgs);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait(lock, [this] { return dispatchRequested || stopRequested; });
+            bool stopping = stopRequested;
+            dispatchRequested = false;
+
+            lock.unlock();
+            dispatchQueuedEvents(env);
+            lock.lock();
+
+            if (stopping) {
+                break;
+            }
+        }
+        lock.unlock();
+
+        javaVM->DetachCurrentThread();
+    }
+
+    void dispatchQueuedEvents(JNIEnv *env) {
+        while (true) {
+            int eventCount = 0;
+            while (eventCount < EVENT_BATCH_CAPACITY && queue.tryPop(eventBatch[eventCount])) {
+                ++eventCount;
+            }
+            if (eventCount == 0) {
+                return;
+            }
+
+            TRACE_SCOPE("handleEventBatch");
+            env->CallVoidMethod(jLib, jMethodIdHandleEventBatch, eventCount);
+            metrics->add(Metric::EVENT_BATCHES);
+            metrics->add(Metric::EVENTS_DISPATCHED, eventCount);
+            if (env->ExceptionCheck()) {
+                metrics->add(Metric::HANDLER_EXCEPTIONS);
+                LOG_E("An exception was thrown by the event handler.");
+                env->ExceptionDescribe();
+                env->ExceptionClear();
+            }
+        }
+    }
+};
+
+// One recognizer owned by a Java MotionLib object, which holds a pointer to it as a jlong
+// handle. All methods are called on the looper thread the instance was created on.
+class MotionLibInstance {
+    MotionMan motionMan;
+
+    JNIEnv *jniEnv;
+    jobject jLib;
+    jobject jEventBatchBuffer;
+    jstring jAccelerationDirectionLabels[DIRECTION_COUNT];
+    jstring jMoveDirectionLabels[DIRECTION_COUNT];
+    std::vector<jstring> jGestureNames;
+    jobject jSampleHistoryBuffer;
+    jobject jEventHistoryBuffer;
+
+    ASensorManager *sensorManager;
+    const ASensor *accelerometer;
+    ALooper *looper;
+    ASensorEventQueue *accelerometerEventQueue;
+    AAsset *gestureSetAsset = NULL;
+
+    EventDispatcher eventDispatcher;
+
+    SampleHistory sampleHistory;
+    EventHistory eventHistory;
+
+    static int sensorEventCallback(int fd, int events, void *data) {
+        (void) fd;
+        (void) events;
+
+        auto instance = static_cast<MotionLibInstance *>(data);
+        instance->motionMan.getMetrics().add(Metric::SENSOR_CALLBACKS);
+        instance->update();
+        return 1; // To continue receiving callbacks.
     }
 
+public:
+    // Prefers the compiled gesture set, which is used straight from the asset buffer and
+    // so must stay open until the instance is destroyed. gesture.yml is still read, to only
+    // use a gesture set compiled from it as it is; hashing it costs far less than parsing.
     void readGestureDefinitionFromAsset(AAssetManager *assetManager) {
         const char *gestureAssetFilename = "gesture.yml";
 
@@ -55,54 +220,33 @@ public:
         const void *gestureAssetBuf = AAsset_getBuffer(gestureAsset);
         assert(gestureAssetBuf != NULL);
         off_t gestureAssetLength = AAsset_getLength(gestureAsset);
-        auto gestureDefinitionsString = std::string(
-                (const char *) gestureAssetBuf,
-                (size_t) gestureAssetLength);
-        AAsset_close(gestureAsset);
 
-        YAML::Node gestureDefinitions = YAML::Load(gestureDefinitionsString.c_str());
-        if (gestureDefinitions.IsSequence()) {
-            try {
-                for (size_t i = 0; i < gestureDefinitions.size(); ++i) {
-                    std::string gestureName = gestureDefinitions[i][0].as<std::string>();
-                    std::string gestureDirectionsString = gestureDefinitions[i][1].as<std::string>();
-                    std::vector<Direction> gestureDirections;
-                    for (const char &dir : gestureDirectionsString) {
-                        switch (dir) {
-                            case 'L':
-                                gestureDirections.push_back(Direction::LEFT);
-                                break;
-                            case 'R':
-                                gestureDirections.push_back(Direction::RIGHT);
-                                break;
-                            case 'U':
-                                gestureDirections.push_back(Direction::UP);
-                                break;
-                            case 'D':
-                                gestureDirections.push_back(Direction::DOWN);
-                                break;
-                            case 'F':
-                                gestureDirections.push_back(Direction::FORWARD);
-                                break;
-                            case 'B':
-                                gestureDirections.push_back(Direction::BACKWARD);
-                                break;
-                            default:
-                                throw std::exception();
-                        }
-                    }
-                    registerGesture(gestureName, gestureDirections);
-                    LOG_I("Gesture registered: %s [%s]", gestureName.c_str(),
-                          gestureDirectionsString.c_str());
-                }
-            } catch (std::exception e) {
-                LOG_E("An error was encountered when reading gesture definitions from file %s.",
-                      gestureAssetFilename);
-                LOG_E("%s", e.what());
+        const char *gestureSetAssetFilename = "gesture.mgs";
+        gestureSetAsset = AAssetManager_open(assetManager, gestureSetAssetFilename,
+                                             AASSET_MODE_BUFFER);
+        if (gestureSetAsset != NULL) {
+            const void *gestureSetBuf = AAsset_getBuffer(gestureSetAsset);
+            size_t gestureSetLength = (size_t) AAsset_getLength(gestureSetAsset);
+            uint32_t sourceHash = gestureSourceHash((const char *) gestureAssetBuf,
+                                                    (size_t) gestureAssetLength);
+            if (gestureSetBuf != NULL &&
+                GestureSet::getSourceHash(gestureSetBuf, gestureSetLength) != sourceHash) {
+                LOG_I("%s was not compiled from the current %s, ignoring it.",
+                      gestureSetAssetFilename, gestureAssetFilename);
+            } else if (gestureSetBuf != NULL &&
+                       motionMan.loadGestureSet(gestureSetBuf, gestureSetLength,
+                                                gestureSetAssetFilename)) {
+                AAsset_close(gestureAsset);
+                return;
             }
-        } else {
-            LOG_E("Bad gesture definitions file format: %s.", gestureAssetFilename);
+            AAsset_close(gestureSetAsset);
+            gestureSetAsset = NULL;
         }
+
+        motionMan.readGestureDefinitions((const char *) gestureAssetBuf,
+                                         (size_t) gestureAssetLength,
+                                         gestureAssetFilename);
+        AAsset_close(gestureAsset);
     }
 
     void initSensor() {
@@ -117,7 +261,7 @@ public:
         accelerometerEventQueue = ASensorManager_createEventQueue(sensorManager, looper,
                                                                   ALOOPER_POLL_CALLBACK,
                                                                   sensorEventCallback,
-                                                                  NULL);
+                                                                  this);
         assert(accelerometerEventQueue != NULL);
     }
 
@@ -125,12 +269,44 @@ public:
         this->jniEnv = env;
         this->jLib = env->NewGlobalRef(jLib);
         jclass clazz = env->GetObjectClass(this->jLib);
-        this->jMethodIdHandleDirectionChange = env->GetMethodID(clazz, "handleDirectionChange",
-                                                                "(Ljava/lang/String;)V");
-        this->jMethodIdHandleMovementDetected = env->GetMethodID(clazz, "handleMovementDetected",
-                                                                 "(Ljava/lang/String;)V");
-        this->jMethodIdHandleGestureDetected = env->GetMethodID(clazz, "handleGestureDetected",
-                                                                "(Ljava/lang/String;)V");
+        jmethodID jMethodIdHandleEventBatch = env->GetMethodID(clazz, "handleEventBatch", "(I)V");
+        env->DeleteLocalRef(clazz);
+
+        this->jEventBatchBuffer = newGlobalDirectByteBuffer(env,
+                                                            eventDispatcher.getEventBatch(),
+                                                            eventDispatcher.getEventBatchSize());
+        this->jSampleHistoryBuffer = newGlobalDirectByteBuffer(env, &sampleHistory,
+                                                               sizeof(sampleHistory));
+        this->jEventHistoryBuffer = newGlobalDirectByteBuffer(env, &eventHistory,
+                                                              sizeof(eventHistory));
+
+        for (int ordinal = 0; ordinal < DIRECTION_COUNT; ++ordinal) {
+            jAccelerationDirectionLabels[ordinal] = newGlobalJavaString(
+                    env, ACCELERATION_DIRECTION_LABELS[ordinal].data());
+            jMoveDirectionLabels[ordinal] = newGlobalJavaString(
+                    env, MOVE_DIRECTION_LABELS[ordinal].data());
+        }
+        const GestureSet &gestureSet = motionMan.getGestureSet();
+        for (int i = 0; i < gestureSet.size(); ++i) {
+            jGestureNames.push_back(newGlobalJavaString(env, gestureSet.getNameCString(i)));
+        }
+
+        eventDispatcher.start(env, this->jLib, jMethodIdHandleEventBatch,
+                              motionMan.getMetrics());
+    }
+
+    static jobject newGlobalDirectByteBuffer(JNIEnv *env, void *address, size_t capacity) {
+        jobject buffer = env->NewDirectByteBuffer(address, capacity);
+        jobject globalBuffer = env->NewGlobalRef(buffer);
+        env->DeleteLocalRef(buffer);
+        return globalBuffer;
+    }
+
+    static jstring newGlobalJavaString(JNIEnv *env, const char *utf) {
+        jstring string = env->NewStringUTF(utf);
+        auto globalString = static_cast<jstring>(env->NewGlobalRef(string));
+        env->DeleteLocalRef(string);
+        return globalString;
     }
 
     void init(AAssetManager *assetManager, JNIEnv *env, jobject jLib) {
@@ -141,6 +317,30 @@ public:
         LOG_V("Initialized.");
     }
 
+    void destroy() {
+        ASensorEventQueue_disableSensor(accelerometerEventQueue, accelerometer);
+        ASensorManager_destroyEventQueue(sensorManager, accelerometerEventQueue);
+        eventDispatcher.stop();
+
+        for (int ordinal = 0; ordinal < DIRECTION_COUNT; ++ordinal) {
+            jniEnv->DeleteGlobalRef(jAccelerationDirectionLabels[ordinal]);
+            jniEnv->DeleteGlobalRef(jMoveDirectionLabels[ordinal]);
+        }
+        for (jstring name : jGestureNames) {
+            jniEnv->DeleteGlobalRef(name);
+        }
+        jniEnv->DeleteGlobalRef(jEventBatchBuffer);
+        jniEnv->DeleteGlobalRef(jSampleHistoryBuffer);
+        jniEnv->DeleteGlobalRef(jEventHistoryBuffer);
+        jniEnv->DeleteGlobalRef(jLib);
+
+        if (gestureSetAsset != NULL) {
+            AAsset_close(gestureSetAsset);
+        }
+
+        LOG_V("Destroyed.");
+    }
+
     void pause() {
         ASensorEventQueue_disableSensor(accelerometerEventQueue, accelerometer);
 
@@ -157,246 +357,241 @@ public:
         LOG_V("Resumed.");
     }
 
-    AccelerometerReadings getLastAccelerometerReadings() {
-        return accelerometerReadings[prevIndex(nextAccelerometerReadingsIndex)];
+    MotionMan &getMotionMan() {
+        return motionMan;
     }
 
-    AccelerationDirectionData getLastAccelerationDirectionData() {
-        return accelerationDirectionData[prevIndex(nextAccelerationDirectionDataIndex)];
-    };
-
-    Direction getLastAccelerationDirection() {
-        return getLastAccelerationDirectionData().direction;
+    void setOverflowPolicy(OverflowPolicy policy) {
+        eventDispatcher.setOverflowPolicy(policy);
     }
 
-    MoveDirectionData getLastMoveDirectionData() {
-        return moveDirectionData[prevIndex(nextMoveDirectionDataIndex)];
+    jobject getEventBatchBuffer() {
+        return jEventBatchBuffer;
     }
 
-    std::string getLastRecognizedGestureName() {
-        return lastRecognizedGestureName;
+    jobject getSampleHistoryBuffer() {
+        return jSampleHistoryBuffer;
     }
 
-    void commitAccelerationDirectionData(Direction direction) {
-        if (direction != getLastAccelerationDirection()) {
-            accelerationDirectionData[nextAccelerationDirectionDataIndex] = {direction, 1, false};
-            invokeDirectionChangeJNIHandler(
-                    accelerationDirectionData[nextAccelerationDirectionDataIndex]);
-            nextAccelerationDirectionDataIndex = nextIndex(nextAccelerationDirectionDataIndex);
-        } else {
-            int index = prevIndex(nextAccelerationDirectionDataIndex);
-            int maxDuring = AccelerationDirectionData::MAX_DURING;
-            int during = std::min<int>(accelerationDirectionData[index].during + 1, maxDuring);
-            accelerationDirectionData[index] = {direction, during,
-                                                accelerationDirectionData[index].isProcessed};
-        }
+    jobject getEventHistoryBuffer() {
+        return jEventHistoryBuffer;
     }
 
-    void commitMoveDirectionData(Direction direction) {
-        moveDirectionData[nextMoveDirectionDataIndex] = {direction, false};
-        invokeMovementDetectedJNIHandler(moveDirectionData[nextMoveDirectionDataIndex]);
-        nextMoveDirectionDataIndex = nextIndex(nextMoveDirectionDataIndex);
-        recognizedMoveDirectionCount++;
+    jstring getAccelerationDirectionLabel(Direction direction) {
+        return jAccelerationDirectionLabels[static_cast<int>(direction)];
     }
 
-    inline bool isPositive(float val) {
-        return val > 2;
+    jstring getMoveDirectionLabel(Direction direction) {
+        return jMoveDirectionLabels[static_cast<int>(direction)];
     }
 
-    inline bool isNegative(float val) {
-        return val < -2;
+    jstring getGestureName(int gestureIndex) {
+        if (gestureIndex < 0) {
+            return getMoveDirectionLabel(Direction::STILL);
+        }
+        return jGestureNames[gestureIndex];
     }
 
-    inline bool isZero(float val) {
-        return !isPositive(val) && !isNegative(val);
+    const jstring *getAccelerationDirectionLabels() {
+        return jAccelerationDirectionLabels;
     }
 
-    void readFromAccelerometer() {
-        ASensorEvent event;
-        while (ASensorEventQueue_getEvents(accelerometerEventQueue, &event, 1) > 0) {
-            float a = SENSOR_FILTER_ALPHA;
-            accelerometerReadingsFilter.x =
-                    a * event.acceleration.x + (1.0f - a) * accelerometerReadingsFilter.x;
-            accelerometerReadingsFilter.y =
-                    a * event.acceleration.y + (1.0f - a) * accelerometerReadingsFilter.y;
-            accelerometerReadingsFilter.z =
-                    a * event.acceleration.z + (1.0f - a) * accelerometerReadingsFilter.z;
-        }
-        accelerometerReadings[nextAccelerometerReadingsIndex] = accelerometerReadingsFilter;
-        nextAccelerometerReadingsIndex = (nextAccelerometerReadingsIndex + 1) % HISTORY_LENGTH;
-
-        if (isZero(accelerometerReadingsFilter.x) && isZero(accelerometerReadingsFilter.y) &&
-            isZero(accelerometerReadingsFilter.z)) {
-            commitAccelerationDirectionData(Direction::STILL);
-        } else if (isNegative(accelerometerReadingsFilter.x)) {
-            commitAccelerationDirectionData(Direction::LEFT);
-        } else if (isPositive(accelerometerReadingsFilter.x)) {
-            commitAccelerationDirectionData(Direction::RIGHT);
-        } else if (isNegative(accelerometerReadingsFilter.y)) {
-            commitAccelerationDirectionData(Direction::BACKWARD);
-        } else if (isPositive(accelerometerReadingsFilter.y)) {
-            commitAccelerationDirectionData(Direction::FORWARD);
-        } else if (isNegative(accelerometerReadingsFilter.z)) {
-            commitAccelerationDirectionData(Direction::DOWN);
-        } else if (isPositive(accelerometerReadingsFilter.z)) {
-            commitAccelerationDirectionData(Direction::UP);
-        }
+    const jstring *getMoveDirectionLabels() {
+        return jMoveDirectionLabels;
     }
 
-    void detectMovement() {
-        auto lastDirectionDataIndex = prevIndex(nextAccelerationDirectionDataIndex);
-        auto lastDirectionData = accelerationDirectionData[lastDirectionDataIndex];
-
-        int currentDirectionDataIndex = prevIndex(lastDirectionDataIndex);
-        if (!lastDirectionData.isProcessed &&
-            lastDirectionData.direction == Direction::STILL &&
-            lastDirectionData.during >= QUIESCENT_THRESHOLD) {
-            AccelerationDirectionData firstDirectionDataAfterLastStill;
-            while (!(accelerationDirectionData[currentDirectionDataIndex].direction ==
-                     Direction::STILL &&
-                     accelerationDirectionData[currentDirectionDataIndex].during >=
-                     QUIESCENT_THRESHOLD)) {
-                firstDirectionDataAfterLastStill = accelerationDirectionData[currentDirectionDataIndex];
-                currentDirectionDataIndex = prevIndex(currentDirectionDataIndex);
-            }
-            int indexOfCurrentDirectionDataIndex = nextIndex(currentDirectionDataIndex);
-
-            if (firstDirectionDataAfterLastStill.isProcessed) {
-                return;
-            }
+    const std::vector<jstring> &getGestureNames() {
+        return jGestureNames;
+    }
 
-            accelerationDirectionData[indexOfCurrentDirectionDataIndex].isProcessed = true;
-            commitMoveDirectionData(firstDirectionDataAfterLastStill.direction);
+    void update() {
+        SensorEventQueueSource source(accelerometerEventQueue);
+        motionMan.update(source);
+        sampleHistory.push(motionMan.getLastAccelerometerReadings());
+
+        TRACE_SCOPE("postEvents");
+        const MotionEvent *events = motionMan.getPendingEvents();
+        for (int i = 0; i < motionMan.getPendingEventCount(); ++i) {
+            eventHistory.push(events[i]);
+            eventDispatcher.post(events[i]);
         }
+        eventDispatcher.endFrame();
     }
+};
 
-    void detectGesture() {
-        int currentMoveDataIndex = prevIndex(nextMoveDirectionDataIndex);
-        if (!moveDirectionData[currentMoveDataIndex].isProcessed) {
-            using GestureDirectionCountAndGestureName = std::pair<int, std::string>;
-            std::vector<GestureDirectionCountAndGestureName> candidates;
-
-            for (const Gesture &gesture : registeredGestures) {
-                bool matched = true;
-
-                int moveDataIndex = currentMoveDataIndex;
-                int gestureDirectionIndex = gesture.directions.size() - 1;
-                while (gestureDirectionIndex >= 0) {
-                    if (moveDirectionData[moveDataIndex].isProcessed ||
-                        moveDirectionData[moveDataIndex].direction !=
-                        gesture.directions[gestureDirectionIndex]) {
-                        matched = false;
-                        break;
-                    }
-                    moveDataIndex = prevIndex(moveDataIndex);
-                    --gestureDirectionIndex;
-                }
-
-                if (matched) {
-                    candidates.push_back({gesture.directions.size(), gesture.name});
-                }
-            }
+// MotionLib.java stops passing a handle before it is destroyed, and waits for the calls
+// which already have it.
+static inline MotionLibInstance *fromHandle(jlong handle) {
+    assert(handle != 0);
+    return reinterpret_cast<MotionLibInstance *>(handle);
+}
 
-            if (candidates.size() > 0) {
-                auto gestureDirectionCountAndGestureName = *std::max_element(candidates.begin(),
-                                                                             candidates.end());
-                int directionCount = gestureDirectionCountAndGestureName.first;
-                std::string name = gestureDirectionCountAndGestureName.second;
-
-                for (int idx = currentMoveDataIndex; directionCount; idx = prevIndex(
-                        idx), --directionCount) {
-                    moveDirectionData[idx].isProcessed = true;
-                }
-                lastRecognizedGestureName = name;
-                invokeGestureDetectedJNIHandler(lastRecognizedGestureName);
-                ++recognizedGestureCount;
-            }
-        }
+jobjectArray newJavaStringArray(JNIEnv *env, const jstring *strings, size_t count) {
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray array = env->NewObjectArray(count, stringClass, NULL);
+    for (size_t i = 0; i < count; ++i) {
+        env->SetObjectArrayElement(array, i, strings[i]);
     }
+    env->DeleteLocalRef(stringClass);
+    return array;
+}
 
-    void update() {
-        auto start = std::chrono::high_resolution_clock::now();
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeCreate(JNIEnv *env, jobject jLib,
+                                                jobject assetManager) {
+    AAssetManager *nativeAssetManager = AAssetManager_fromJava(env, assetManager);
+    auto instance = new MotionLibInstance();
+    instance->init(nativeAssetManager, env, jLib);
+    return reinterpret_cast<jlong>(instance);
+}
 
-        readFromAccelerometer();
-        detectMovement();
-        detectGesture();
+extern "C"
+JNIEXPORT void JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    (void) env;
+    (void) clazz;
 
-        auto stop = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<float, std::milli> diff = stop - start;
-        LOG_V("An update took %fms.", diff.count());
-    }
+    MotionLibInstance *instance = fromHandle(handle);
+    instance->destroy();
+    delete instance;
+}
 
-    void invokeDirectionChangeJNIHandler(const AccelerationDirectionData &directionData) {
-        jstring direction = jniEnv->NewStringUTF(directionData.toString().c_str());
-        jniEnv->CallVoidMethod(jLib, jMethodIdHandleDirectionChange, direction);
-    }
+extern "C"
+JNIEXPORT void JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeResume(JNIEnv *env, jclass clazz, jlong handle) {
+    (void) env;
+    (void) clazz;
 
-    void invokeMovementDetectedJNIHandler(const MoveDirectionData &moveData) {
-        jstring movement = jniEnv->NewStringUTF(moveData.toString().c_str());
-        jniEnv->CallVoidMethod(jLib, jMethodIdHandleMovementDetected, movement);
-    }
+    fromHandle(handle)->resume();
+}
 
-    void invokeGestureDetectedJNIHandler(const std::string &gestureName) {
-        jstring jGestureName = jniEnv->NewStringUTF(gestureName.c_str());
-        jniEnv->CallVoidMethod(jLib, jMethodIdHandleGestureDetected, jGestureName);
-    }
-};
+extern "C"
+JNIEXPORT void JNICALL
+Java_net_qfstudio_motion_MotionLib_nativePause(JNIEnv *env, jclass clazz, jlong handle) {
+    (void) env;
+    (void) clazz;
 
-MotionMan motionMan;
+    fromHandle(handle)->pause();
+}
 
-int motionMan_SensorEventCallback(int fd, int events, void *data) {
-    (void) fd;
-    (void) events;
-    (void) data;
+extern "C"
+JNIEXPORT void JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeUpdate(JNIEnv *env, jclass clazz, jlong handle) {
+    (void) env;
+    (void) clazz;
 
-    motionMan.update();
-    return 1; // To continue receiving callbacks.
+    fromHandle(handle)->update();
 }
-ALooper_callbackFunc sensorEventCallback = &motionMan_SensorEventCallback;
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_net_qfstudio_motion_MotionLib_initUnderlyingNativeLib(JNIEnv *env, jobject jLib,
-                                                           jobject assetManager) {
+Java_net_qfstudio_motion_MotionLib_nativeSetOverflowPolicy(JNIEnv *env, jclass clazz,
+                                                           jlong handle, jint policy) {
     (void) env;
-    (void) jLib;
+    (void) clazz;
 
-    AAssetManager *nativeAssetManager = AAssetManager_fromJava(env, assetManager);
-    motionMan.init(nativeAssetManager, env, jLib);
+    fromHandle(handle)->setOverflowPolicy(static_cast<OverflowPolicy>(policy));
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_net_qfstudio_motion_MotionLib_resume(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeSetSubscriptions(JNIEnv *env, jclass clazz,
+                                                          jlong handle, jint mask) {
     (void) env;
     (void) clazz;
 
-    motionMan.resume();
+    fromHandle(handle)->getMotionMan().setSubscriptionMask(static_cast<uint32_t>(mask));
 }
 
 extern "C"
-JNIEXPORT void JNICALL
-Java_net_qfstudio_motion_MotionLib_pause(JNIEnv *env, jobject clazz) {
+JNIEXPORT jlong JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetSuppressedEventCount(JNIEnv *env, jclass clazz,
+                                                                 jlong handle, jint eventType) {
     (void) env;
     (void) clazz;
-    motionMan.pause();
+
+    MotionMan &motionMan = fromHandle(handle)->getMotionMan();
+    return motionMan.getSuppressedEventCount(static_cast<MotionEventType>(eventType));
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetLatencySummary(JNIEnv *env, jclass clazz,
+                                                           jlong handle, jint stage) {
+    (void) clazz;
+
+    const PipelineLatencies &latencies = fromHandle(handle)->getMotionMan().getLatencies();
+    LatencySummary summary = latencies.summarize(static_cast<PipelineStage>(stage));
+    jlong buf[LATENCY_SUMMARY_FIELD_COUNT] = {
+            (jlong) summary.count, (jlong) summary.p50, (jlong) summary.p99,
+            (jlong) summary.p999, (jlong) summary.max
+    };
+
+    jlongArray jSummary = env->NewLongArray(LATENCY_SUMMARY_FIELD_COUNT);
+    env->SetLongArrayRegion(jSummary, 0, LATENCY_SUMMARY_FIELD_COUNT, buf);
+    return jSummary;
 }
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_net_qfstudio_motion_MotionLib_update(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeDumpLatencies(JNIEnv *env, jclass clazz, jlong handle) {
     (void) env;
     (void) clazz;
 
-    motionMan.update();
+    fromHandle(handle)->getMotionMan().getLatencies().dump();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetMetrics(JNIEnv *env, jclass clazz, jlong handle,
+                                                    jlongArray values) {
+    (void) clazz;
+
+    jlong buf[METRIC_COUNT];
+    static_assert(sizeof(jlong) == sizeof(int64_t), "Metrics are copied as jlong.");
+    const Metrics &metrics = fromHandle(handle)->getMotionMan().getMetrics();
+    int count = metrics.snapshot(reinterpret_cast<int64_t *>(buf), METRIC_COUNT);
+    jsize length = env->GetArrayLength(values);
+    env->SetLongArrayRegion(values, 0, length < count ? length : count, buf);
+    return count;
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetMetricNames(JNIEnv *env, jclass clazz) {
+    (void) clazz;
+
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray names = env->NewObjectArray(METRIC_COUNT, stringClass, NULL);
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        jstring name = env->NewStringUTF(METRIC_NAMES[i]);
+        env->SetObjectArrayElement(names, i, name);
+        env->DeleteLocalRef(name);
+    }
+    env->DeleteLocalRef(stringClass);
+    return names;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeDumpFlightRecorder(JNIEnv *env, jclass clazz,
+                                                            jlong handle, jstring path) {
+    (void) clazz;
+
+    const char *nativePath = env->GetStringUTFChars(path, NULL);
+    bool dumped = fromHandle(handle)->getMotionMan().getFlightRecorder().dump(nativePath);
+    env->ReleaseStringUTFChars(path, nativePath);
+    return static_cast<jboolean>(dumped);
 }
 
 extern "C"
 JNIEXPORT jfloatArray JNICALL
-Java_net_qfstudio_motion_MotionLib_getLastMeterReadings(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeGetLastMeterReadings(JNIEnv *env, jclass clazz,
+                                                              jlong handle) {
     (void) clazz;
 
-    auto data = motionMan.getLastAccelerometerReadings();
+    auto data = fromHandle(handle)->getMotionMan().getLastAccelerometerReadings();
     jfloatArray jData = env->NewFloatArray(3);
 
     jfloat buf[3];
@@ -410,27 +605,126 @@ Java_net_qfstudio_motion_MotionLib_getLastMeterReadings(JNIEnv *env, jobject cla
 
 extern "C"
 JNIEXPORT jstring JNICALL
-Java_net_qfstudio_motion_MotionLib_getLastMovement(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeGetLastMovement(JNIEnv *env, jclass clazz,
+                                                         jlong handle) {
+    (void) env;
     (void) clazz;
 
-    MoveDirectionData moveData = motionMan.getLastMoveDirectionData();
-    return env->NewStringUTF(moveData.toString().c_str());
+    MotionLibInstance *instance = fromHandle(handle);
+    MoveDirectionData moveData = instance->getMotionMan().getLastMoveDirectionData();
+    return instance->getMoveDirectionLabel(moveData.direction);
 }
 
 extern "C"
 JNIEXPORT jstring JNICALL
-Java_net_qfstudio_motion_MotionLib_getLastGesture(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeGetLastGesture(JNIEnv *env, jclass clazz,
+                                                        jlong handle) {
+    (void) env;
     (void) clazz;
 
-    return env->NewStringUTF(motionMan.getLastRecognizedGestureName().c_str());
+    MotionLibInstance *instance = fromHandle(handle);
+    return instance->getGestureName(instance->getMotionMan().getLastRecognizedGestureIndex());
 }
 
 extern "C"
 JNIEXPORT jstring JNICALL
-Java_net_qfstudio_motion_MotionLib_getLastDirection(JNIEnv *env, jobject clazz) {
+Java_net_qfstudio_motion_MotionLib_nativeGetLastDirection(JNIEnv *env, jclass clazz,
+                                                          jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    MotionLibInstance *instance = fromHandle(handle);
+    auto data = instance->getMotionMan().getLastAccelerationDirectionData();
+    return instance->getAccelerationDirectionLabel(data.direction);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetLastDirectionOrdinal(JNIEnv *env, jclass clazz,
+                                                                 jlong handle) {
     (void) env;
     (void) clazz;
 
-    auto data = motionMan.getLastAccelerationDirectionData();
-    return env->NewStringUTF(data.toString().c_str());
-}
\ No newline at end of file
+    return static_cast<jint>(fromHandle(handle)->getMotionMan().getLastAccelerationDirection());
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetLastMovementOrdinal(JNIEnv *env, jclass clazz,
+                                                                jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    MotionMan &motionMan = fromHandle(handle)->getMotionMan();
+    return static_cast<jint>(motionMan.getLastMoveDirectionData().direction);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetLastGestureId(JNIEnv *env, jclass clazz,
+                                                          jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    return fromHandle(handle)->getMotionMan().getLastRecognizedGestureIndex();
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetEventBatchBuffer(JNIEnv *env, jclass clazz,
+                                                             jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    return fromHandle(handle)->getEventBatchBuffer();
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetSampleHistoryBuffer(JNIEnv *env, jclass clazz,
+                                                                jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    return fromHandle(handle)->getSampleHistoryBuffer();
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetEventHistoryBuffer(JNIEnv *env, jclass clazz,
+                                                               jlong handle) {
+    (void) env;
+    (void) clazz;
+
+    return fromHandle(handle)->getEventHistoryBuffer();
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetDirectionLabels(JNIEnv *env, jclass clazz,
+                                                            jlong handle) {
+    (void) clazz;
+
+    return newJavaStringArray(env, fromHandle(handle)->getAccelerationDirectionLabels(),
+                              DIRECTION_COUNT);
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetMovementLabels(JNIEnv *env, jclass clazz,
+                                                           jlong handle) {
+    (void) clazz;
+
+    return newJavaStringArray(env, fromHandle(handle)->getMoveDirectionLabels(),
+                              DIRECTION_COUNT);
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_net_qfstudio_motion_MotionLib_nativeGetGestureNames(JNIEnv *env, jclass clazz,
+                                                         jlong handle) {
+    (void) clazz;
+
+    const std::vector<jstring> &names = fromHandle(handle)->getGestureNames();
+    return newJavaStringArray(env, names.data(), names.size());
+}
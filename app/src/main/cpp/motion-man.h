@@ -0,0 +1,444 @@
+#ifndef MOTION_MAN_H
+#define MOTION_MAN_H
+
+// Recognition pipeline shared by the Android library and host-side tools.
+// Nothing in here may depend on Android or JNI headers.
+
+#include "motion-types.h"
+#include "gesture-set.h"
+#include "latency-histogram.h"
+#include "metrics.h"
+#include "flight-recorder.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+
+// Supplies the raw samples which arrived since the previous update.
+class AccelerometerSource {
+public:
+    virtual ~AccelerometerSource() = default;
+
+    virtual bool nextReadings(AccelerometerReadings &readings) = 0;
+};
+
+// The recognizer. HistoryLength bounds how many samples, directions and moves are kept;
+// gestures of as many moves or more can never match.
+template<int HistoryLength = HISTORY_LENGTH>
+class BasicMotionMan {
+    static_assert(HistoryLength > QUIESCENT_THRESHOLD, "The history must hold a full pause.");
+
+    GestureSet gestureSet;
+    DetectionParameters detection;
+
+    AccelerometerReadings accelerometerReadings[HistoryLength];
+    AccelerometerReadings accelerometerReadingsFilter = {0, 0, 0};
+    int nextAccelerometerReadingsIndex = 1;
+
+
+    AccelerationDirectionData accelerationDirectionData[HistoryLength] = {
+            {Direction::STILL, AccelerationDirectionData::MAX_DURING, true}
+    };
+    int nextAccelerationDirectionDataIndex = 1;
+
+    uint32_t updateCount = 0;
+    // The first direction of the move in progress, which it is recognized as, or STILL
+    // between moves, and the strongest acceleration towards it so far.
+    Direction moveDirection = Direction::STILL;
+    float movePeakAcceleration = 0.0f;
+
+    MoveDirectionData moveDirectionData[HistoryLength] = {{Direction::STILL, true}};
+    int nextMoveDirectionDataIndex = 1;
+
+    int lastRecognizedGestureIndex = -1;
+
+    MotionEvent pendingEvents[MAX_EVENTS_PER_UPDATE];
+    int pendingEventCount = 0;
+
+    std::atomic<uint32_t> subscriptionMask{SUBSCRIBE_ALL};
+    Metrics metrics;
+    FlightRecorder flightRecorder;
+
+    PipelineLatencies latencies;
+
+public:
+    inline int prevIndex(int index) {
+        return (index - 1 + HistoryLength) % HistoryLength;
+    }
+
+    inline int nextIndex(int index) {
+        return (index + 1) % HistoryLength;
+    }
+
+    // Compiles gesture.yml at runtime. Gestures before a malformed entry are kept.
+    void readGestureDefinitions(const char *source, size_t length, const char *sourceName) {
+        std::vector<Gesture> gestures;
+        DetectionParameters parameters;
+        parseGestureDefinitions(source, length, sourceName, gestures, &parameters);
+        if (!setDetectionParameters(parameters)) {
+            parameters = DetectionParameters();
+            setDetectionParameters(parameters);
+        }
+        if (!gestureSet.assign(gestures, parameters)) {
+            LOG_E("Cannot compile the gestures of %s.", sourceName);
+        }
+        metrics.set(Metric::GESTURES_LOADED, gestureSet.size());
+    }
+
+    // Uses a compiled gesture set in place; the image must outlive this MotionMan.
+    bool loadGestureSet(const void *image, size_t size, const char *sourceName) {
+        if (!gestureSet.view(image, size, sourceName)) {
+            return false;
+        }
+        if (!setDetectionParameters(gestureSet.getDetectionParameters())) {
+            gestureSet.clear();
+            return false;
+        }
+        for (int i = 0; i < gestureSet.size(); ++i) {
+            LOG_I("Gesture registered: %s", gestureSet.getNameCString(i));
+        }
+        metrics.set(Metric::GESTURES_LOADED, gestureSet.size());
+        return true;
+    }
+
+    // Takes effect from a fresh history, see resetHistory(). Loading a gesture set applies
+    // the parameters it was compiled with.
+    bool setDetectionParameters(const DetectionParameters &parameters) {
+        if (!(parameters.filterAlpha > 0.0f && parameters.filterAlpha <= 1.0f) ||
+            !(parameters.directionThreshold > 0.0f) ||
+            parameters.quiescentThreshold < 1 || parameters.quiescentThreshold >= HistoryLength ||
+            parameters.maxDuring < parameters.quiescentThreshold) {
+            LOG_E("Invalid detection parameters: alpha %g, threshold %g, quiescent %d, during %d.",
+                  parameters.filterAlpha, parameters.directionThreshold,
+                  parameters.quiescentThreshold, parameters.maxDuring);
+            return false;
+        }
+        detection = parameters;
+        resetHistory();
+        return true;
+    }
+
+    const DetectionParameters &getDetectionParameters() {
+        return detection;
+    }
+
+    // Forgets every sample, direction and move as if newly constructed, keeping the gesture
+    // set, the subscriptions and what has been measured. For replaying recordings one
+    // after another with the same recognizer.
+    void resetHistory() {
+        std::fill(std::begin(accelerometerReadings), std::end(accelerometerReadings),
+                  AccelerometerReadings{0, 0, 0});
+        accelerometerReadingsFilter = {0, 0, 0};
+        nextAccelerometerReadingsIndex = 1;
+
+        std::fill(std::begin(accelerationDirectionData), std::end(accelerationDirectionData),
+                  AccelerationDirectionData{});
+        accelerationDirectionData[0] = {Direction::STILL, detection.maxDuring, true};
+        nextAccelerationDirectionDataIndex = 1;
+
+        updateCount = 0;
+        moveDirection = Direction::STILL;
+        movePeakAcceleration = 0.0f;
+
+        std::fill(std::begin(moveDirectionData), std::end(moveDirectionData), MoveDirectionData{});
+        moveDirectionData[0] = {Direction::STILL, true};
+        nextMoveDirectionDataIndex = 1;
+
+        lastRecognizedGestureIndex = -1;
+        pendingEventCount = 0;
+    }
+
+    AccelerometerReadings getLastAccelerometerReadings() {
+        return accelerometerReadings[prevIndex(nextAccelerometerReadingsIndex)];
+    }
+
+    AccelerationDirectionData getLastAccelerationDirectionData() {
+        return accelerationDirectionData[prevIndex(nextAccelerationDirectionDataIndex)];
+    };
+
+    Direction getLastAccelerationDirection() {
+        return getLastAccelerationDirectionData().direction;
+    }
+
+    MoveDirectionData getLastMoveDirectionData() {
+        return moveDirectionData[prevIndex(nextMoveDirectionDataIndex)];
+    }
+
+    int getLastRecognizedGestureIndex() {
+        return lastRecognizedGestureIndex;
+    }
+
+    const GestureSet &getGestureSet() {
+        return gestureSet;
+    }
+
+    // Events of unsubscribed types are never produced, so none of the work of delivering
+    // them is done either. May be called from any thread.
+    void setSubscriptionMask(uint32_t mask) {
+        subscriptionMask.store(mask, std::memory_order_relaxed);
+    }
+
+    uint64_t getSuppressedEventCount(MotionEventType type) {
+        return static_cast<uint64_t>(metrics.get(suppressedMetricOf(type)));
+    }
+
+    static Metric suppressedMetricOf(MotionEventType type) {
+        return static_cast<Metric>(static_cast<int>(Metric::DIRECTION_CHANGES_SUPPRESSED) +
+                                   static_cast<int>(type));
+    }
+
+    // The last FLIGHT_RECORDER_SECONDS of samples and decisions. May be dumped from any thread.
+    const FlightRecorder &getFlightRecorder() {
+        return flightRecorder;
+    }
+
+    // Shared with whoever delivers the events, which adds its own metrics.
+    Metrics &getMetrics() {
+        return metrics;
+    }
+
+    // Time spent in each stage of update(). May be read from any thread.
+    const PipelineLatencies &getLatencies() {
+        return latencies;
+    }
+
+    // Events produced by the last update, in the order they happened.
+    const MotionEvent *getPendingEvents() {
+        return pendingEvents;
+    }
+
+    int getPendingEventCount() {
+        return pendingEventCount;
+    }
+
+    void commitAccelerationDirectionData(Direction direction) {
+        if (direction != getLastAccelerationDirection()) {
+            accelerationDirectionData[nextAccelerationDirectionDataIndex] = {direction, 1, false};
+            queueEvent(MotionEventType::DIRECTION_CHANGE, static_cast<int32_t>(direction));
+            metrics.add(Metric::DIRECTION_CHANGES);
+            nextAccelerationDirectionDataIndex = nextIndex(nextAccelerationDirectionDataIndex);
+        } else {
+            int index = prevIndex(nextAccelerationDirectionDataIndex);
+            int during = std::min<int>(accelerationDirectionData[index].during + 1,
+                                       detection.maxDuring);
+            accelerationDirectionData[index] = {direction, during,
+                                                accelerationDirectionData[index].isProcessed};
+        }
+    }
+
+    void commitMoveDirectionData(Direction direction) {
+        moveDirectionData[nextMoveDirectionDataIndex] = {direction, false, updateCount,
+                                                         movePeakAcceleration};
+        flightRecorder.recordMove(direction, movePeakAcceleration);
+        queueEvent(MotionEventType::MOVEMENT_DETECTED, static_cast<int32_t>(direction));
+        nextMoveDirectionDataIndex = nextIndex(nextMoveDirectionDataIndex);
+        metrics.add(Metric::MOVES);
+    }
+
+    inline bool isPositive(float val) {
+        return val > detection.directionThreshold;
+    }
+
+    inline bool isNegative(float val) {
+        return val < -detection.directionThreshold;
+    }
+
+    inline bool isZero(float val) {
+        return !isPositive(val) && !isNegative(val);
+    }
+
+    void readFromAccelerometer(AccelerometerSource &source) {
+        TRACE_SCOPE("readFromAccelerometer");
+
+        AccelerometerReadings readings;
+        int sampleCount = 0;
+        while (source.nextReadings(readings)) {
+            ++sampleCount;
+            flightRecorder.recordSample(readings);
+            float a = detection.filterAlpha;
+            accelerometerReadingsFilter.x =
+                    a * readings.x + (1.0f - a) * accelerometerReadingsFilter.x;
+            accelerometerReadingsFilter.y =
+                    a * readings.y + (1.0f - a) * accelerometerReadingsFilter.y;
+            accelerometerReadingsFilter.z =
+                    a * readings.z + (1.0f - a) * accelerometerReadingsFilter.z;
+        }
+        metrics.add(Metric::SAMPLES, sampleCount);
+        accelerometerReadings[nextAccelerometerReadingsIndex] = accelerometerReadingsFilter;
+        nextAccelerometerReadingsIndex = (nextAccelerometerReadingsIndex + 1) % HistoryLength;
+
+        if (isZero(accelerometerReadingsFilter.x) && isZero(accelerometerReadingsFilter.y) &&
+            isZero(accelerometerReadingsFilter.z)) {
+            commitAccelerationDirectionData(Direction::STILL);
+            return;
+        }
+
+        Direction direction;
+        if (isNegative(accelerometerReadingsFilter.x)) {
+            direction = Direction::LEFT;
+        } else if (isPositive(accelerometerReadingsFilter.x)) {
+            direction = Direction::RIGHT;
+        } else if (isNegative(accelerometerReadingsFilter.y)) {
+            direction = Direction::BACKWARD;
+        } else if (isPositive(accelerometerReadingsFilter.y)) {
+            direction = Direction::FORWARD;
+        } else if (isNegative(accelerometerReadingsFilter.z)) {
+            direction = Direction::DOWN;
+        } else {
+            direction = Direction::UP;
+        }
+        if (moveDirection == Direction::STILL) {
+            moveDirection = direction;
+            movePeakAcceleration = 0.0f;
+        }
+        movePeakAcceleration = std::max(movePeakAcceleration,
+                                        accelerationTowards(moveDirection));
+        commitAccelerationDirectionData(direction);
+    }
+
+    // The filtered acceleration along the axis of `direction`, positive towards it.
+    float accelerationTowards(Direction direction) {
+        switch (direction) {
+            case Direction::LEFT:
+                return -accelerometerReadingsFilter.x;
+            case Direction::RIGHT:
+                return accelerometerReadingsFilter.x;
+            case Direction::BACKWARD:
+                return -accelerometerReadingsFilter.y;
+            case Direction::FORWARD:
+                return accelerometerReadingsFilter.y;
+            case Direction::DOWN:
+                return -accelerometerReadingsFilter.z;
+            case Direction::UP:
+                return accelerometerReadingsFilter.z;
+            default:
+                return 0.0f;
+        }
+    }
+
+    void detectMovement() {
+        TRACE_SCOPE("detectMovement");
+
+        auto lastDirectionDataIndex = prevIndex(nextAccelerationDirectionDataIndex);
+        auto lastDirectionData = accelerationDirectionData[lastDirectionDataIndex];
+
+        int currentDirectionDataIndex = prevIndex(lastDirectionDataIndex);
+        if (!lastDirectionData.isProcessed &&
+            lastDirectionData.direction == Direction::STILL &&
+            lastDirectionData.during >= detection.quiescentThreshold) {
+            // Nothing to commit if the still follows another one.
+            AccelerationDirectionData firstDirectionDataAfterLastStill = {Direction::STILL, 1, true};
+            while (!(accelerationDirectionData[currentDirectionDataIndex].direction ==
+                     Direction::STILL &&
+                     accelerationDirectionData[currentDirectionDataIndex].during >=
+                     detection.quiescentThreshold)) {
+                firstDirectionDataAfterLastStill = accelerationDirectionData[currentDirectionDataIndex];
+                currentDirectionDataIndex = prevIndex(currentDirectionDataIndex);
+            }
+            int indexOfCurrentDirectionDataIndex = nextIndex(currentDirectionDataIndex);
+
+            if (!firstDirectionDataAfterLastStill.isProcessed) {
+                accelerationDirectionData[indexOfCurrentDirectionDataIndex].isProcessed = true;
+                commitMoveDirectionData(firstDirectionDataAfterLastStill.direction);
+            }
+            // The move is over, whether committed now, before, or not at all.
+            moveDirection = Direction::STILL;
+            movePeakAcceleration = 0.0f;
+        }
+    }
+
+    void detectGesture() {
+        TRACE_SCOPE("detectGesture");
+
+        int currentMoveDataIndex = prevIndex(nextMoveDirectionDataIndex);
+        if (!moveDirectionData[currentMoveDataIndex].isProcessed) {
+            uint32_t lastMoveUpdate = moveDirectionData[currentMoveDataIndex].update;
+            for (int rank = 0; rank < gestureSet.size(); ++rank) {
+                int gestureIndex = gestureSet.getMatchOrder(rank);
+                const GestureRecord &gesture = gestureSet.getRecord(gestureIndex);
+                int directionCount = gesture.directionCount;
+                if (directionCount >= HistoryLength) {
+                    continue;
+                }
+                const uint8_t *gestureDirections = gestureSet.getDirectionsNewestFirst(gestureIndex);
+                bool matched = true;
+
+                int moveDataIndex = currentMoveDataIndex;
+                uint32_t laterMoveUpdate = lastMoveUpdate;
+                for (int gestureDirectionIndex = 0;
+                     gestureDirectionIndex < directionCount; ++gestureDirectionIndex) {
+                    const MoveDirectionData &move = moveDirectionData[moveDataIndex];
+                    if (move.isProcessed ||
+                        static_cast<uint8_t>(move.direction) !=
+                        gestureDirections[gestureDirectionIndex] ||
+                        move.peakAcceleration < gesture.minPeakAcceleration ||
+                        (gesture.moveTimeout && laterMoveUpdate - move.update > gesture.moveTimeout) ||
+                        (gesture.maxDuration && lastMoveUpdate - move.update > gesture.maxDuration)) {
+                        matched = false;
+                        break;
+                    }
+                    laterMoveUpdate = move.update;
+                    moveDataIndex = prevIndex(moveDataIndex);
+                }
+
+                if (matched) {
+                    for (int idx = currentMoveDataIndex; directionCount; idx = prevIndex(
+                            idx), --directionCount) {
+                        moveDirectionData[idx].isProcessed = true;
+                    }
+                    lastRecognizedGestureIndex = gestureIndex;
+                    flightRecorder.recordGesture(gestureIndex);
+                    queueEvent(MotionEventType::GESTURE_DETECTED, gestureIndex);
+                    metrics.add(Metric::GESTURES);
+                    break;
+                }
+            }
+        }
+    }
+
+    // update() is beginUpdate(), the three stages and endUpdate(). Tools measuring the
+    // stages separately call them one by one.
+    void beginUpdate() {
+        pendingEventCount = 0;
+        ++updateCount;
+        metrics.add(Metric::UPDATES);
+        flightRecorder.beginUpdate(updateCount);
+    }
+
+    void endUpdate() {
+        flightRecorder.endUpdate(getLastAccelerationDirection());
+    }
+
+    void update(AccelerometerSource &source) {
+        TRACE_SCOPE("update");
+
+        beginUpdate();
+        auto readStart = PipelineLatencies::Clock::now();
+        readFromAccelerometer(source);
+        auto movementStart = PipelineLatencies::Clock::now();
+        detectMovement();
+        auto gestureStart = PipelineLatencies::Clock::now();
+        detectGesture();
+        auto stop = PipelineLatencies::Clock::now();
+        endUpdate();
+
+        latencies.record(PipelineStage::READ, readStart, movementStart);
+        latencies.record(PipelineStage::MOVEMENT, movementStart, gestureStart);
+        latencies.record(PipelineStage::GESTURE, gestureStart, stop);
+    }
+
+    void queueEvent(MotionEventType type, int32_t code) {
+        if (!(subscriptionMask.load(std::memory_order_relaxed) & subscriptionBit(type))) {
+            metrics.add(suppressedMetricOf(type));
+            return;
+        }
+        pendingEvents[pendingEventCount++] = {type, code};
+    }
+};
+
+using MotionMan = BasicMotionMan<>;
+
+#endif // MOTION_MAN_H
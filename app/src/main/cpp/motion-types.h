@@ -0,0 +1,143 @@
+#ifndef MOTION_TYPES_H
+#define MOTION_TYPES_H
+
+// Types and constants shared by the Android library and host-side tools.
+// Nothing in here may depend on Android or JNI headers.
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef __ANDROID__
+
+#include <android/log.h>
+
+#define LOG_TAG    "MotionLib"
+#define LOG_V(...) __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG, __VA_ARGS__)
+#define LOG_I(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOG_E(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#else
+
+#include <atomic>
+#include <cstdio>
+
+// Turned off by host tools which load gesture sets over and over.
+inline std::atomic<bool> hostInfoLogging{true};
+
+#define LOG_TAG    "MotionLib"
+#define LOG_V(...) ((void) 0)
+#define LOG_I(...) (hostInfoLogging.load(std::memory_order_relaxed) ?                      \
+                    (void) (std::fprintf(stderr, LOG_TAG ": " __VA_ARGS__),                 \
+                            std::fputc('\n', stderr)) : (void) 0)
+#define LOG_E(...) (std::fprintf(stderr, LOG_TAG ": " __VA_ARGS__), std::fputc('\n', stderr))
+
+#endif
+
+const static int HISTORY_LENGTH = 100;
+const static float constexpr SENSOR_FILTER_ALPHA = 0.1f;
+const static int QUIESCENT_THRESHOLD = 16;
+// Filtered acceleration (m/s²) beyond which the phone counts as accelerating along an axis.
+const static float constexpr DIRECTION_THRESHOLD = 2.0f;
+// MotionMan::update() runs once per sensor batch, at this rate.
+const static int UPDATE_RATE_HZ = 100;
+
+struct AccelerometerReadings {
+    float x;
+    float y;
+    float z;
+};
+
+enum struct Direction {
+    STILL = 0,
+    LEFT, RIGHT, UP, DOWN, FORWARD, BACKWARD
+};
+
+const static int constexpr DIRECTION_COUNT = static_cast<int>(Direction::BACKWARD) + 1;
+
+// Localized labels indexed by Direction ordinal. Every label views a string literal,
+// so `data()` is NUL-terminated and can be handed to JNI directly.
+using DirectionLabelTable = std::array<std::string_view, DIRECTION_COUNT>;
+
+constexpr DirectionLabelTable ACCELERATION_DIRECTION_LABELS = {
+        "静止", "向左", "向右", "向上", "向下", "向前", "向后"
+};
+
+constexpr DirectionLabelTable MOVE_DIRECTION_LABELS = {
+        "静止", "左移", "右移", "上移", "下移", "前移", "后移"
+};
+
+struct AccelerationDirectionData {
+    Direction direction;
+    int during = 1;
+    bool isProcessed = false;
+
+    const static int MAX_DURING = 25;
+
+    constexpr std::string_view label() const {
+        return ACCELERATION_DIRECTION_LABELS[static_cast<int>(direction)];
+    }
+};
+
+// How raw samples become moves. The defaults are the constants above; gesture.yml may
+// override them for a whole gesture set.
+struct DetectionParameters {
+    float filterAlpha = SENSOR_FILTER_ALPHA;        // Weight of a new sample in the low-pass filter.
+    float directionThreshold = DIRECTION_THRESHOLD; // See DIRECTION_THRESHOLD.
+    int quiescentThreshold = QUIESCENT_THRESHOLD;   // Still updates which end a move.
+    int maxDuring = AccelerationDirectionData::MAX_DURING; // Updates a direction is counted up to.
+};
+
+struct MoveDirectionData {
+    Direction direction;
+    bool isProcessed = false;
+    uint32_t update = 0;             // MotionMan update count when the move was recognized.
+    float peakAcceleration = 0.0f;   // Strongest filtered acceleration during the move.
+
+    constexpr std::string_view label() const {
+        return MOVE_DIRECTION_LABELS[static_cast<int>(direction)];
+    }
+};
+
+enum struct MotionEventType : int32_t {
+    DIRECTION_CHANGE = 0,
+    MOVEMENT_DETECTED,
+    GESTURE_DETECTED
+};
+
+const static int constexpr MOTION_EVENT_TYPE_COUNT =
+        static_cast<int>(MotionEventType::GESTURE_DETECTED) + 1;
+
+// Subscription mask bits, one per MotionEventType.
+const static uint32_t constexpr SUBSCRIBE_ALL = (1u << MOTION_EVENT_TYPE_COUNT) - 1;
+
+constexpr uint32_t subscriptionBit(MotionEventType type) {
+    return 1u << static_cast<int>(type);
+}
+
+// Binary event record shared with Java through a direct ByteBuffer.
+// Keep in sync with MotionEventBatch.java.
+struct MotionEvent {
+    MotionEventType type;
+    int32_t code; // Direction ordinal, or index of the registered gesture.
+};
+
+static_assert(sizeof(MotionEvent) == 8, "MotionEvent layout is shared with Java.");
+
+// At most one event of each type is produced by a single update.
+const static int MAX_EVENTS_PER_UPDATE = 3;
+
+struct Gesture {
+    std::string name;
+    std::vector<Direction> directions;
+    int priority = 0;                            // Higher priorities are matched first.
+    int maxDurationMs = 0;                       // From the first to the last move, 0 for no limit.
+    int moveTimeoutMs = 0;                       // Between two consecutive moves, 0 for no limit.
+    float sensitivity = 0.0f;                    // Peak acceleration every move must reach,
+                                                 // 0 for just directionThreshold.
+};
+
+#endif // MOTION_TYPES_H
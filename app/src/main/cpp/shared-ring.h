@@ -0,0 +1,42 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size history written by a single thread and read by others without locks,
+// including from Java through a direct ByteBuffer (see MotionHistory.java).
+//
+// Readers follow the seqlock protocol: read `sequence`, retry while it is odd, copy
+// the records, then retry if `sequence` changed in the meantime.
+template<typename T, int Capacity>
+struct SharedRing {
+    std::atomic<uint32_t> sequence{0};
+    int32_t capacity = Capacity;
+    int64_t count = 0; // Number of records ever pushed; the next one goes to count % Capacity.
+    T records[Capacity];
+
+    void push(const T &record) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        records[count % Capacity] = record;
+        count = count + 1;
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+};
+
+// Byte offsets relied upon by MotionHistory.java, checked against the rings motion-lib.h
+// shares.
+const static int SHARED_RING_SEQUENCE_OFFSET = 0;
+const static int SHARED_RING_CAPACITY_OFFSET = 4;
+const static int SHARED_RING_COUNT_OFFSET = 8;
+const static int SHARED_RING_RECORDS_OFFSET = 16;
+
+static_assert(sizeof(std::atomic<uint32_t>) == 4 && std::atomic<uint32_t>::is_always_lock_free,
+              "SharedRing::sequence is read from Java as a plain int.");
+
+#endif // SHARED_RING_H
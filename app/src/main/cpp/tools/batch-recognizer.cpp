@@ -0,0 +1,271 @@
+// Re-runs recognition over an archive of recorded sessions.
+//
+//     batch-recognizer <gesture.yml|gesture.mgs> <sessions> <out> [--threads <n>]
+//
+// Every *.csv sample file below <sessions> is replayed from scratch, and the gestures it
+// contains are written to <out>/<relative path>.events, one `update,time/ms,gesture` line
+// each. <out>/summary.csv counts every gesture over the whole archive.
+//
+// Sessions are dealt largest first to one queue per worker thread; a worker whose queue
+// runs dry steals from the back of the others. Each worker owns a single recognizer,
+// reset between sessions, and all of them use the same compiled gesture set.
+
+#include "sample-file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+struct SessionFile {
+    fs::path path;
+    uintmax_t size;
+};
+
+// Indices of sessions. The owner takes from the front, thieves from the back.
+class WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> sessions;
+
+public:
+    void push(size_t session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sessions.push_back(session);
+    }
+
+    bool pop(size_t &session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sessions.empty()) {
+            return false;
+        }
+        session = sessions.front();
+        sessions.pop_front();
+        return true;
+    }
+
+    bool steal(size_t &session) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sessions.empty()) {
+            return false;
+        }
+        session = sessions.back();
+        sessions.pop_back();
+        return true;
+    }
+};
+
+struct WorkerStats {
+    int sessions = 0;
+    int failures = 0;
+    int steals = 0;
+    uint64_t samples = 0;
+    std::vector<int64_t> gestures;        // Recognitions per gesture.
+    std::vector<int64_t> gestureSessions; // Sessions containing each gesture.
+};
+
+class BatchRecognizer {
+    const std::vector<uint8_t> &gestureSetImage;
+    const std::vector<SessionFile> &sessions;
+    const fs::path sessionRoot;
+    const fs::path outputRoot;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+public:
+    BatchRecognizer(const std::vector<uint8_t> &gestureSetImage,
+                    const std::vector<SessionFile> &sessions, fs::path sessionRoot,
+                    fs::path outputRoot, int workerCount)
+            : gestureSetImage(gestureSetImage), sessions(sessions),
+              sessionRoot(std::move(sessionRoot)), outputRoot(std::move(outputRoot)) {
+        for (int i = 0; i < workerCount; ++i) {
+            queues.emplace_back(new WorkQueue());
+        }
+        // `sessions` is sorted largest first, so every queue gets a similar amount of work.
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            queues[i % workerCount]->push(i);
+        }
+    }
+
+    void work(int worker, WorkerStats &stats) {
+        auto motionMan = std::unique_ptr<MotionMan>(new MotionMan());
+        motionMan->loadGestureSet(gestureSetImage.data(), gestureSetImage.size(), "<batch>");
+        stats.gestures.assign(motionMan->getGestureSet().size(), 0);
+        stats.gestureSessions.assign(motionMan->getGestureSet().size(), 0);
+
+        std::vector<AccelerometerReadings> samples;
+        std::vector<int64_t> sessionGestures;
+        size_t session;
+        while (next(worker, session, stats)) {
+            samples.clear();
+            ++stats.sessions;
+            if (!readSampleFile(sessions[session].path.c_str(), samples) ||
+                !recognize(*motionMan, sessions[session].path, samples, sessionGestures)) {
+                ++stats.failures;
+                continue;
+            }
+            stats.samples += samples.size();
+            for (size_t i = 0; i < sessionGestures.size(); ++i) {
+                stats.gestures[i] += sessionGestures[i];
+                stats.gestureSessions[i] += sessionGestures[i] > 0;
+            }
+        }
+    }
+
+private:
+    bool next(int worker, size_t &session, WorkerStats &stats) {
+        if (queues[worker]->pop(session)) {
+            return true;
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            if (queues[(worker + i) % queues.size()]->steal(session)) {
+                ++stats.steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool recognize(MotionMan &motionMan, const fs::path &path,
+                   const std::vector<AccelerometerReadings> &samples,
+                   std::vector<int64_t> &sessionGestures) {
+        const GestureSet &gestureSet = motionMan.getGestureSet();
+        sessionGestures.assign(gestureSet.size(), 0);
+
+        fs::path outputPath = outputRoot / fs::relative(path, sessionRoot);
+        outputPath.replace_extension(".events");
+        std::error_code error;
+        fs::create_directories(outputPath.parent_path(), error);
+        FILE *output = std::fopen(outputPath.c_str(), "w");
+        if (output == nullptr) {
+            std::fprintf(stderr, "Cannot write %s.\n", outputPath.c_str());
+            return false;
+        }
+
+        motionMan.resetHistory();
+        ReplaySource source;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            source.next(samples[i]);
+            motionMan.update(source);
+            const MotionEvent *events = motionMan.getPendingEvents();
+            for (int e = 0; e < motionMan.getPendingEventCount(); ++e) {
+                if (events[e].type == MotionEventType::GESTURE_DETECTED) {
+                    ++sessionGestures[events[e].code];
+                    size_t update = i + 1;
+                    std::fprintf(output, "%zu,%zu,%s\n", update, update * 1000 / UPDATE_RATE_HZ,
+                                 gestureSet.getNameCString(events[e].code));
+                }
+            }
+        }
+        if (std::fclose(output) != 0) {
+            std::fprintf(stderr, "Cannot write %s.\n", outputPath.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<const char *> paths;
+    int workerCount = (int) std::max(1u, std::thread::hardware_concurrency());
+    bool valid = true;
+    for (int i = 1; valid && i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            workerCount = std::atoi(argv[++i]);
+            valid = workerCount > 0;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (!valid || paths.size() != 3) {
+        std::fprintf(stderr, "Usage: %s <gesture.yml|gesture.mgs> <sessions> <out> "
+                             "[--threads <n>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> gestureSetImage;
+    if (!compileGestureFile(paths[0], gestureSetImage)) {
+        return 1;
+    }
+
+    std::vector<SessionFile> sessions;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(paths[1], error), end; !error && it != end;
+         it.increment(error)) {
+        if (it->is_regular_file() && it->path().extension() == ".csv") {
+            sessions.push_back({it->path(), it->file_size()});
+        }
+    }
+    if (error) {
+        std::fprintf(stderr, "Cannot list %s: %s.\n", paths[1], error.message().c_str());
+        return 1;
+    }
+    if (sessions.empty()) {
+        std::fprintf(stderr, "No *.csv sessions below %s.\n", paths[1]);
+        return 1;
+    }
+    std::sort(sessions.begin(), sessions.end(), [](const SessionFile &a, const SessionFile &b) {
+        return a.size != b.size ? a.size > b.size : a.path < b.path;
+    });
+    fs::create_directories(paths[2], error);
+
+    workerCount = std::min<int>(workerCount, (int) sessions.size());
+    BatchRecognizer recognizer(gestureSetImage, sessions, paths[1], paths[2], workerCount);
+    std::vector<WorkerStats> stats(workerCount);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&BatchRecognizer::work, &recognizer, i, std::ref(stats[i]));
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    WorkerStats total;
+    GestureSet gestureSet;
+    gestureSet.view(gestureSetImage.data(), gestureSetImage.size(), paths[0]);
+    total.gestures.assign(gestureSet.size(), 0);
+    total.gestureSessions.assign(gestureSet.size(), 0);
+    std::printf("%6s %8s %6s %10s\n", "worker", "sessions", "steals", "samples");
+    for (int i = 0; i < workerCount; ++i) {
+        std::printf("%6d %8d %6d %10llu\n", i, stats[i].sessions, stats[i].steals,
+                    (unsigned long long) stats[i].samples);
+        total.sessions += stats[i].sessions;
+        total.failures += stats[i].failures;
+        total.samples += stats[i].samples;
+        for (int g = 0; g < gestureSet.size(); ++g) {
+            total.gestures[g] += stats[i].gestures[g];
+            total.gestureSessions[g] += stats[i].gestureSessions[g];
+        }
+    }
+
+    fs::path summaryPath = fs::path(paths[2]) / "summary.csv";
+    FILE *summary = std::fopen(summaryPath.c_str(), "w");
+    if (summary == nullptr) {
+        std::fprintf(stderr, "Cannot write %s.\n", summaryPath.c_str());
+        return 1;
+    }
+    std::fprintf(summary, "gesture,count,sessions\n");
+    for (int g = 0; g < gestureSet.size(); ++g) {
+        std::fprintf(summary, "%s,%lld,%lld\n", gestureSet.getNameCString(g),
+                     (long long) total.gestures[g], (long long) total.gestureSessions[g]);
+    }
+    bool written = std::fclose(summary) == 0;
+
+    std::printf("\n%d sessions (%d failed), %llu samples (%.1f h) in %.2f s: %.0f samples/s "
+                "on %d threads\n", total.sessions, total.failures,
+                (unsigned long long) total.samples,
+                (double) total.samples / UPDATE_RATE_HZ / 3600, seconds,
+                total.samples / seconds, workerCount);
+    if (!written) {
+        std::fprintf(stderr, "Cannot write %s.\n", summaryPath.c_str());
+    }
+    return written && total.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// Replays a labeled corpus through the recognizer and checks accuracy and speed.
+//
+//     corpus-regression <gesture.yml|gesture.mgs> <corpus>... [--match-window-ms <ms>]
+//                       [--min-precision <0..1>] [--min-recall <0..1>]
+//                       [--max-latency-ms <ms>] [--min-samples-per-second <n>]
+//
+// Corpora and how detections are matched to labels are described in corpus.h. Every
+// session is replayed from a fresh history.
+//
+// Prints precision, recall and mean latency per gesture, and the throughput of the whole
+// run. Exits with 1 when a bound is not met: precision and recall are checked per gesture,
+// latency is the mean over all matches. At least one bound must be given, or there would
+// be nothing to check. corpus/ holds a labeled corpus which ctest checks this way.
+//
+// Its sessions are synthesized, by generators independent of the recognizer and of
+// sample-file.h, as no device recordings are available yet. A recording is made by
+// dumping the flight recorder with MotionLib.dumpFlightRecorder() right after performing
+// gestures, exporting its samples with `flight-decoder <dump.mfr> --samples <out.csv>`
+// and adding a `#label` line after the last sample of every gesture performed.
+
+#include "corpus.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+static double toMilliseconds(double updates) {
+    return updates * 1000.0 / UPDATE_RATE_HZ;
+}
+
+int main(int argc, char *argv[]) {
+    const char *gesturePath = nullptr;
+    std::vector<const char *> corpusPaths;
+    double matchWindowMs = 1000;
+    double minPrecision = -1, minRecall = -1, maxLatencyMs = -1, minSamplesPerSecond = -1;
+    bool valid = true;
+    for (int i = 1; valid && i < argc; ++i) {
+        double *option = nullptr;
+        if (std::strcmp(argv[i], "--match-window-ms") == 0) {
+            option = &matchWindowMs;
+        } else if (std::strcmp(argv[i], "--min-precision") == 0) {
+            option = &minPrecision;
+        } else if (std::strcmp(argv[i], "--min-recall") == 0) {
+            option = &minRecall;
+        } else if (std::strcmp(argv[i], "--max-latency-ms") == 0) {
+            option = &maxLatencyMs;
+        } else if (std::strcmp(argv[i], "--min-samples-per-second") == 0) {
+            option = &minSamplesPerSecond;
+        } else if (argv[i][0] != '-' || argv[i][1] == '\0') {
+            if (gesturePath == nullptr) {
+                gesturePath = argv[i];
+            } else {
+                corpusPaths.push_back(argv[i]);
+            }
+            continue;
+        }
+        char *end = nullptr;
+        valid = option != nullptr && i + 1 < argc;
+        if (valid) {
+            *option = std::strtod(argv[++i], &end);
+            valid = end != argv[i] && *end == '\0';
+        }
+    }
+    bool hasBound = minPrecision >= 0 || minRecall >= 0 || maxLatencyMs >= 0 ||
+                    minSamplesPerSecond >= 0;
+    if (!valid || gesturePath == nullptr || corpusPaths.empty() || !hasBound) {
+        std::fprintf(stderr, "Usage: %s <gesture.yml|gesture.mgs> <corpus>... "
+                             "[--match-window-ms <ms>]\n"
+                             "       [--min-precision <0..1>] [--min-recall <0..1>] "
+                             "[--max-latency-ms <ms>] [--min-samples-per-second <n>]\n"
+                             "At least one bound is required.\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> gestureSetImage;
+    auto motionMan = std::unique_ptr<MotionMan>(new MotionMan());
+    if (!compileGestureFile(gesturePath, gestureSetImage) ||
+        !motionMan->loadGestureSet(gestureSetImage.data(), gestureSetImage.size(), gesturePath)) {
+        return 1;
+    }
+    const GestureSet &gestureSet = motionMan->getGestureSet();
+
+    std::vector<Session> sessions;
+    for (const char *path : corpusPaths) {
+        if (!readCorpus(path, gestureSet, sessions)) {
+            return 1;
+        }
+    }
+
+    auto matchWindow = (int) (matchWindowMs * UPDATE_RATE_HZ / 1000);
+    std::vector<GestureScore> scores(gestureSet.size());
+    double seconds = 0;
+    size_t sampleCount = 0;
+    for (const Session &session : sessions) {
+        scoreSession(*motionMan, session, matchWindow, scores, seconds);
+        sampleCount += session.samples.size();
+    }
+
+    std::string failures;
+    GestureScore total;
+    std::printf("%-24s %6s %8s %7s %9s %6s %10s\n", "gesture", "labels", "detected", "matched",
+                "precision", "recall", "latency/ms");
+    for (int i = 0; i < gestureSet.size(); ++i) {
+        const GestureScore &gestureScore = scores[i];
+        total.add(gestureScore);
+
+        std::printf("%-24s %6d %8d %7d", gestureSet.getNameCString(i), gestureScore.labels,
+                    gestureScore.detections, gestureScore.matches);
+        if (gestureScore.detections > 0) {
+            double precision = (double) gestureScore.matches / gestureScore.detections;
+            std::printf(" %9.3f", precision);
+            if (precision < minPrecision) {
+                failures += "Precision of " + std::string(gestureSet.getName(i)) +
+                            " is below the bound.\n";
+            }
+        } else {
+            std::printf(" %9s", "-");
+        }
+        if (gestureScore.labels > 0) {
+            double recall = (double) gestureScore.matches / gestureScore.labels;
+            std::printf(" %6.3f", recall);
+            if (recall < minRecall) {
+                failures += "Recall of " + std::string(gestureSet.getName(i)) +
+                            " is below the bound.\n";
+            }
+        } else {
+            std::printf(" %6s", "-");
+        }
+        if (gestureScore.matches > 0) {
+            std::printf(" %10.1f\n", toMilliseconds(gestureScore.meanLatencyUpdates()));
+        } else {
+            std::printf(" %10s\n", "-");
+        }
+    }
+
+    double meanLatencyMs = toMilliseconds(total.meanLatencyUpdates());
+    double samplesPerSecond = seconds > 0 ? sampleCount / seconds : 0;
+    std::printf("\n%zu sessions, %zu samples (%.1f s), %d labels, %d detections, %d matched\n",
+                sessions.size(), sampleCount, (double) sampleCount / UPDATE_RATE_HZ,
+                total.labels, total.detections, total.matches);
+    std::printf("mean latency %.1f ms, %.0f samples/s\n", meanLatencyMs, samplesPerSecond);
+
+    if (maxLatencyMs >= 0 && meanLatencyMs > maxLatencyMs) {
+        failures += "Mean latency exceeds the bound.\n";
+    }
+    if (minSamplesPerSecond >= 0 && samplesPerSecond < minSamplesPerSecond) {
+        failures += "Throughput is below the bound.\n";
+    }
+    std::printf("\n%s%s\n", failures.c_str(), failures.empty() ? "PASSED" : "FAILED");
+    return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+// Labeled recordings and how well a recognizer does on them.
+//
+// A corpus is a labeled sample file (see sample-file.h), a directory of them (*.csv), or
+// `-` for a synthetic session performing every gesture once. A recognized gesture is a
+// true positive when an unmatched label of the same gesture lies within the match window
+// around it, and a false positive otherwise; labels left unmatched are misses. Detection
+// latency is the time from the label to the update which recognized the gesture, and 0
+// for a gesture recognized before its label, as a label placed late by hand would
+// otherwise make the recognizer look faster.
+
+#include "sample-file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+struct GestureScore {
+    int labels = 0;
+    int detections = 0;
+    int matches = 0;
+    int64_t latencyUpdates = 0;
+
+    void add(const GestureScore &other) {
+        labels += other.labels;
+        detections += other.detections;
+        matches += other.matches;
+        latencyUpdates += other.latencyUpdates;
+    }
+
+    // 1 when there is nothing to find and nothing was found.
+    double f1() const {
+        return labels + detections > 0 ? 2.0 * matches / (labels + detections) : 1.0;
+    }
+
+    double meanLatencyUpdates() const {
+        return matches > 0 ? (double) latencyUpdates / matches : 0.0;
+    }
+};
+
+struct Session {
+    std::string name;
+    std::vector<AccelerometerReadings> samples;
+    std::vector<SampleLabel> labels;
+    std::vector<int> labelGestures; // Gesture index of every label.
+};
+
+// Appends the sessions of one corpus. Labels must name gestures of the set.
+inline bool readCorpus(const char *path, const GestureSet &gestureSet,
+                       std::vector<Session> &sessions) {
+    namespace fs = std::filesystem;
+    size_t first = sessions.size();
+    if (std::strcmp(path, "-") == 0) {
+        sessions.emplace_back();
+        sessions.back().name = "<synthetic>";
+        synthesizeGestures(gestureSet, sessions.back().samples, &sessions.back().labels);
+    } else {
+        std::vector<std::string> files;
+        std::error_code error;
+        if (fs::is_directory(path, error)) {
+            for (const fs::directory_entry &entry : fs::directory_iterator(path, error)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".csv") {
+                    files.push_back(entry.path().string());
+                }
+            }
+            if (files.empty()) {
+                std::fprintf(stderr, "No *.csv sessions in %s.\n", path);
+                return false;
+            }
+            std::sort(files.begin(), files.end());
+        } else {
+            files.emplace_back(path);
+        }
+        for (const std::string &file : files) {
+            sessions.emplace_back();
+            sessions.back().name = file;
+            if (!readSampleFile(file.c_str(), sessions.back().samples, &sessions.back().labels)) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t s = first; s < sessions.size(); ++s) {
+        Session &session = sessions[s];
+        for (const SampleLabel &label : session.labels) {
+            int gestureIndex = -1;
+            for (int i = 0; i < gestureSet.size() && gestureIndex < 0; ++i) {
+                if (gestureSet.getName(i) == label.gesture) {
+                    gestureIndex = i;
+                }
+            }
+            if (gestureIndex < 0) {
+                std::fprintf(stderr, "%s: label of unknown gesture \"%s\".\n",
+                             session.name.c_str(), label.gesture.c_str());
+                return false;
+            }
+            session.labelGestures.push_back(gestureIndex);
+        }
+    }
+    return true;
+}
+
+// Replays a session from a fresh history and adds the outcome to `scores`, one per
+// gesture, and the time spent recognizing to `seconds`.
+template<int HistoryLength>
+void scoreSession(BasicMotionMan<HistoryLength> &motionMan, const Session &session,
+                  int matchWindow, std::vector<GestureScore> &scores, double &seconds) {
+    for (int gestureIndex : session.labelGestures) {
+        ++scores[gestureIndex].labels;
+    }
+
+    // (update, gesture) of every recognized gesture.
+    std::vector<std::pair<size_t, int>> detections;
+    motionMan.resetHistory();
+    ReplaySource source;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < session.samples.size(); ++i) {
+        source.next(session.samples[i]);
+        motionMan.update(source);
+        const MotionEvent *events = motionMan.getPendingEvents();
+        for (int e = 0; e < motionMan.getPendingEventCount(); ++e) {
+            if (events[e].type == MotionEventType::GESTURE_DETECTED) {
+                detections.emplace_back(i + 1, events[e].code);
+            }
+        }
+    }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<bool> matched(session.labels.size(), false);
+    for (const auto &detection : detections) {
+        GestureScore &score = scores[detection.second];
+        ++score.detections;
+        for (size_t l = 0; l < session.labels.size(); ++l) {
+            auto distance = (int64_t) detection.first - (int64_t) session.labels[l].sample;
+            if (!matched[l] && session.labelGestures[l] == detection.second &&
+                std::abs(distance) <= matchWindow) {
+                matched[l] = true;
+                ++score.matches;
+                score.latencyUpdates += std::max<int64_t>(distance, 0);
+                break;
+            }
+        }
+    }
+}
+
+#endif // CORPUS_H
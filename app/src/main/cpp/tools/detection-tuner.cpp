@@ -0,0 +1,278 @@
+// Searches the detection parameters for the best accuracy and latency on a labeled corpus.
+//
+//     detection-tuner <gesture.yml|gesture.mgs> <corpus>... [--random <n>] [--seed <n>]
+//                     [--threads <n>] [--match-window-ms <ms>] [--output <gesture.yml>]
+//
+// Evaluates a grid over the detection parameters of gesture.yml (filterAlpha,
+// directionThreshold, quiescentTime and maxDirectionTime, see parseGestureDefinitions()),
+// or as many random configurations within the same ranges with --random. Configurations
+// are evaluated in parallel, each worker replaying the whole corpus (see corpus.h) with
+// its own recognizer. Accuracy is the F1 score over all gestures.
+//
+// Prints the Pareto front of accuracy against mean detection latency, and the winner: the
+// most accurate configuration, the faster one on ties. Configurations which match no label
+// have no latency to compare and are left out. --output writes the gesture set
+// with the winner's detection parameters, in the gesture.yml format.
+
+#include "corpus.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+struct Evaluation {
+    DetectionParameters parameters;
+    bool valid = false;
+    double f1 = 0;
+    double latencyMs = 0;
+    int matches = 0;
+};
+
+static std::vector<DetectionParameters> gridConfigurations() {
+    std::vector<DetectionParameters> configurations;
+    for (float filterAlpha : {0.05f, 0.1f, 0.15f, 0.2f, 0.3f}) {
+        for (float directionThreshold : {1.5f, 2.0f, 2.5f, 3.0f}) {
+            for (int quiescentThreshold : {8, 12, 16, 20, 24}) {
+                for (int maxDuring : {16, 25, 40}) {
+                    if (maxDuring >= quiescentThreshold) {
+                        configurations.push_back({filterAlpha, directionThreshold,
+                                                  quiescentThreshold, maxDuring});
+                    }
+                }
+            }
+        }
+    }
+    return configurations;
+}
+
+static std::vector<DetectionParameters> randomConfigurations(int count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> filterAlphaOf(0.03f, 0.4f);
+    std::uniform_real_distribution<float> directionThresholdOf(1.0f, 4.0f);
+    std::uniform_int_distribution<int> quiescentThresholdOf(4, 40);
+    std::vector<DetectionParameters> configurations;
+    for (int i = 0; i < count; ++i) {
+        DetectionParameters parameters;
+        parameters.filterAlpha = std::round(filterAlphaOf(random) * 1000) / 1000;
+        parameters.directionThreshold = std::round(directionThresholdOf(random) * 100) / 100;
+        parameters.quiescentThreshold = quiescentThresholdOf(random);
+        parameters.maxDuring = std::uniform_int_distribution<int>(
+                parameters.quiescentThreshold, 60)(random);
+        configurations.push_back(parameters);
+    }
+    return configurations;
+}
+
+static std::string quoted(std::string_view text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+// The counterpart of parseGestureDefinitions().
+static bool writeGestureDefinitions(const char *path, const GestureSet &gestureSet,
+                                    const DetectionParameters &detection) {
+    FILE *file = std::fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "detection:\n"
+                       "  filterAlpha: %g\n"
+                       "  directionThreshold: %g\n"
+                       "  quiescentTime: %d\n"
+                       "  maxDirectionTime: %d\n"
+                       "gestures:\n",
+                 detection.filterAlpha, detection.directionThreshold,
+                 updatesToMilliseconds(detection.quiescentThreshold),
+                 updatesToMilliseconds(detection.maxDuring));
+    for (int i = 0; i < gestureSet.size(); ++i) {
+        std::string path;
+        const uint8_t *directions = gestureSet.getDirectionsNewestFirst(i);
+        for (int d = gestureSet.getDirectionCount(i) - 1; d >= 0; --d) {
+            path += "SLRUDFB"[directions[d]];
+        }
+        const GestureRecord &record = gestureSet.getRecord(i);
+        std::string name = quoted(gestureSet.getName(i));
+        // Sensitivities up to the new directionThreshold make no difference, and may not
+        // be written below it.
+        bool hasSensitivity = record.minPeakAcceleration > detection.directionThreshold;
+        if (record.priority == 0 && record.maxDuration == 0 && record.moveTimeout == 0 &&
+            !hasSensitivity) {
+            std::fprintf(file, "  - [%s, %s]\n", name.c_str(), path.c_str());
+            continue;
+        }
+        std::fprintf(file, "  - name: %s\n"
+                           "    path: %s\n"
+                           "    priority: %d\n"
+                           "    maxDuration: %d\n"
+                           "    moveTimeout: %d\n",
+                     name.c_str(), path.c_str(), record.priority,
+                     updatesToMilliseconds(record.maxDuration),
+                     updatesToMilliseconds(record.moveTimeout));
+        if (hasSensitivity) {
+            std::fprintf(file, "    sensitivity: %g\n", record.minPeakAcceleration);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+static void printEvaluation(const char *label, const Evaluation &evaluation) {
+    const DetectionParameters &p = evaluation.parameters;
+    std::printf("%-8s %6.3f %10.1f %6.3f %9.2f %9d %8d\n", label, evaluation.f1,
+                evaluation.latencyMs, p.filterAlpha, p.directionThreshold,
+                updatesToMilliseconds(p.quiescentThreshold), updatesToMilliseconds(p.maxDuring));
+}
+
+int main(int argc, char *argv[]) {
+    const char *gesturePath = nullptr;
+    const char *outputPath = nullptr;
+    std::vector<const char *> corpusPaths;
+    int randomCount = 0;
+    unsigned seed = 1;
+    int workerCount = (int) std::max(1u, std::thread::hardware_concurrency());
+    double matchWindowMs = 1000;
+    bool valid = true;
+    for (int i = 1; valid && i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--random") == 0 && hasValue) {
+            randomCount = std::atoi(argv[++i]);
+            valid = randomCount > 0;
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = (unsigned) std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            workerCount = std::atoi(argv[++i]);
+            valid = workerCount > 0;
+        } else if (std::strcmp(argv[i], "--match-window-ms") == 0 && hasValue) {
+            matchWindowMs = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (argv[i][0] != '-' || argv[i][1] == '\0') {
+            if (gesturePath == nullptr) {
+                gesturePath = argv[i];
+            } else {
+                corpusPaths.push_back(argv[i]);
+            }
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || gesturePath == nullptr || corpusPaths.empty()) {
+        std::fprintf(stderr, "Usage: %s <gesture.yml|gesture.mgs> <corpus>... [--random <n>] "
+                             "[--seed <n>]\n"
+                             "       [--threads <n>] [--match-window-ms <ms>] "
+                             "[--output <gesture.yml>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> gestureSetImage;
+    GestureSet gestureSet;
+    if (!compileGestureFile(gesturePath, gestureSetImage) ||
+        !gestureSet.view(gestureSetImage.data(), gestureSetImage.size(), gesturePath)) {
+        return 1;
+    }
+    std::vector<Session> sessions;
+    for (const char *path : corpusPaths) {
+        if (!readCorpus(path, gestureSet, sessions)) {
+            return 1;
+        }
+    }
+
+    // The parameters the gesture set has now come first, as the baseline.
+    std::vector<Evaluation> evaluations(1);
+    evaluations[0].parameters = gestureSet.getDetectionParameters();
+    for (const DetectionParameters &parameters : randomCount > 0 ?
+                                                 randomConfigurations(randomCount, seed) :
+                                                 gridConfigurations()) {
+        evaluations.emplace_back();
+        evaluations.back().parameters = parameters;
+    }
+
+    auto matchWindow = (int) (matchWindowMs * UPDATE_RATE_HZ / 1000);
+    std::atomic<size_t> nextEvaluation{0};
+    auto evaluate = [&]() {
+        auto motionMan = std::unique_ptr<MotionMan>(new MotionMan());
+        motionMan->loadGestureSet(gestureSetImage.data(), gestureSetImage.size(), gesturePath);
+        std::vector<GestureScore> scores(gestureSet.size());
+        for (size_t i = nextEvaluation++; i < evaluations.size(); i = nextEvaluation++) {
+            Evaluation &evaluation = evaluations[i];
+            if (!motionMan->setDetectionParameters(evaluation.parameters)) {
+                continue;
+            }
+            std::fill(scores.begin(), scores.end(), GestureScore());
+            double seconds = 0;
+            for (const Session &session : sessions) {
+                scoreSession(*motionMan, session, matchWindow, scores, seconds);
+            }
+            GestureScore total;
+            for (const GestureScore &score : scores) {
+                total.add(score);
+            }
+            evaluation.valid = true;
+            evaluation.f1 = total.f1();
+            evaluation.latencyMs = total.meanLatencyUpdates() * 1000.0 / UPDATE_RATE_HZ;
+            evaluation.matches = total.matches;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(evaluate);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Sorted by latency, every configuration more accurate than all faster ones.
+    std::vector<const Evaluation *> front;
+    for (const Evaluation &evaluation : evaluations) {
+        if (evaluation.valid && evaluation.matches > 0) {
+            front.push_back(&evaluation);
+        }
+    }
+    std::sort(front.begin(), front.end(), [](const Evaluation *a, const Evaluation *b) {
+        return a->latencyMs != b->latencyMs ? a->latencyMs < b->latencyMs : a->f1 > b->f1;
+    });
+    double bestF1 = -1;
+    front.erase(std::remove_if(front.begin(), front.end(), [&bestF1](const Evaluation *e) {
+        if (e->f1 <= bestF1) {
+            return true;
+        }
+        bestF1 = e->f1;
+        return false;
+    }), front.end());
+    if (front.empty()) {
+        std::fprintf(stderr, "No configuration recognized any labeled gesture.\n");
+        return 1;
+    }
+    const Evaluation &winner = *front.back();
+
+    std::printf("%zu configurations on %zu sessions, %d threads\n\n", evaluations.size(),
+                sessions.size(), workerCount);
+    std::printf("%-8s %6s %10s %6s %9s %9s %8s\n", "", "f1", "latency/ms", "alpha",
+                "threshold", "quiescent", "maxDir");
+    for (const Evaluation *evaluation : front) {
+        printEvaluation("pareto", *evaluation);
+    }
+    std::printf("\n");
+    printEvaluation("current", evaluations[0]);
+    printEvaluation("winner", winner);
+
+    if (outputPath != nullptr) {
+        if (!writeGestureDefinitions(outputPath, gestureSet, winner.parameters)) {
+            std::fprintf(stderr, "Cannot write %s.\n", outputPath);
+            return 1;
+        }
+        std::printf("\nWrote %s.\n", outputPath);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Decodes a flight recorder dump written by MotionLib.dumpFlightRecorder().
+//
+//     flight-decoder <dump.mfr> [--gestures <gesture.yml|gesture.mgs>] [--samples <out.csv>]
+//
+// Prints every update in which the direction changed or a move or gesture was recognized.
+// --samples exports the raw samples for the other replay tools. --gestures replays the
+// samples through a fresh recognizer and reports the updates where it decided differently;
+// decisions before the recognizer has seen a full move may differ as it starts without
+// the history the device had.
+
+#include "sample-file.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static const char *directionCode(uint8_t direction) {
+    static const char *CODES[DIRECTION_COUNT] = {"-", "L", "R", "U", "D", "F", "B"};
+    return direction < DIRECTION_COUNT ? CODES[direction] : "?";
+}
+
+int main(int argc, char *argv[]) {
+    const char *dumpPath = nullptr;
+    const char *gesturePath = nullptr;
+    const char *samplesPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--gestures") == 0 && i + 1 < argc) {
+            gesturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samplesPath = argv[++i];
+        } else if (dumpPath == nullptr && argv[i][0] != '-') {
+            dumpPath = argv[i];
+        } else {
+            dumpPath = nullptr;
+            break;
+        }
+    }
+    if (dumpPath == nullptr) {
+        std::fprintf(stderr, "Usage: %s <dump.mfr> [--gestures <gesture.yml|gesture.mgs>] "
+                             "[--samples <out.csv>]\n", argv[0]);
+        return 2;
+    }
+
+    MappedFile dump;
+    if (!dump.open(dumpPath) || dump.length() < sizeof(FlightRecorderHeader)) {
+        std::fprintf(stderr, "Cannot read %s.\n", dumpPath);
+        return 1;
+    }
+    FlightRecorderHeader header;
+    std::memcpy(&header, dump.data(), sizeof(header));
+    if (header.magic != FLIGHT_RECORDER_MAGIC || header.version != FLIGHT_RECORDER_VERSION ||
+        dump.length() != sizeof(header) + header.recordCount * sizeof(FlightRecord) +
+                         header.sampleCount * sizeof(FlightSample)) {
+        std::fprintf(stderr, "%s is not a flight recorder dump of version %d.\n", dumpPath,
+                     FLIGHT_RECORDER_VERSION);
+        return 1;
+    }
+
+    std::vector<FlightRecord> records(header.recordCount);
+    std::memcpy(records.data(), dump.data() + sizeof(header),
+                records.size() * sizeof(FlightRecord));
+    std::vector<AccelerometerReadings> samples;
+    const char *sampleData = dump.data() + sizeof(header) + records.size() * sizeof(FlightRecord);
+    for (uint32_t i = 0; i < header.sampleCount; ++i) {
+        FlightSample sample;
+        std::memcpy(&sample, sampleData + i * sizeof(FlightSample), sizeof(sample));
+        samples.push_back({sample.x * header.sampleScale, sample.y * header.sampleScale,
+                           sample.z * header.sampleScale});
+    }
+
+    std::printf("%u updates (%.2f s at %d Hz), %u samples\n\n", header.recordCount,
+                (double) header.recordCount / header.updateRateHz, header.updateRateHz,
+                header.sampleCount);
+    std::printf("%10s %8s %9s %5s %9s %7s\n", "update", "time/s", "direction", "move", "peak",
+                "gesture");
+    uint8_t lastDirection = static_cast<uint8_t>(Direction::STILL);
+    for (const FlightRecord &record : records) {
+        bool moved = record.move != static_cast<uint8_t>(Direction::STILL);
+        if (record.direction == lastDirection && !moved && record.gesture < 0) {
+            continue;
+        }
+        lastDirection = record.direction;
+        std::printf("%10u %8.2f %9s %5s", record.update,
+                    (double) (record.update - records[0].update) / header.updateRateHz,
+                    directionCode(record.direction), moved ? directionCode(record.move) : "");
+        if (moved) {
+            std::printf(" %9.2f", record.movePeak * header.sampleScale);
+        } else {
+            std::printf(" %9s", "");
+        }
+        if (record.gesture >= 0) {
+            std::printf(" %7d", record.gesture);
+        }
+        std::printf("\n");
+    }
+
+    if (samplesPath != nullptr && !writeSampleFile(samplesPath, samples)) {
+        std::fprintf(stderr, "Cannot write %s.\n", samplesPath);
+        return 1;
+    }
+
+    if (gesturePath != nullptr) {
+        MappedFile gestureFile;
+        MotionMan motionMan;
+        if (!loadGestureFile(motionMan, gestureFile, gesturePath)) {
+            return 1;
+        }
+
+        ReplaySource source;
+        size_t nextSample = 0;
+        int differences = 0;
+        std::printf("\nReplay differences:\n");
+        for (const FlightRecord &record : records) {
+            source.next(samples.data() + nextSample, record.sampleCount);
+            nextSample += record.sampleCount;
+            motionMan.update(source);
+
+            int move = static_cast<int>(Direction::STILL);
+            int gesture = -1;
+            const MotionEvent *events = motionMan.getPendingEvents();
+            for (int i = 0; i < motionMan.getPendingEventCount(); ++i) {
+                if (events[i].type == MotionEventType::MOVEMENT_DETECTED) {
+                    move = events[i].code;
+                } else if (events[i].type == MotionEventType::GESTURE_DETECTED) {
+                    gesture = events[i].code;
+                }
+            }
+            if (move != record.move || gesture != record.gesture) {
+                std::printf("%10u  recorded move %s gesture %d, replayed move %s gesture %d\n",
+                            record.update, directionCode(record.move), record.gesture,
+                            directionCode(static_cast<uint8_t>(move)), gesture);
+                ++differences;
+            }
+        }
+        std::printf("%d updates differ.\n", differences);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// Compiles gesture.yml into the binary gesture set loaded by motion-lib.
+//
+//     gesture-compiler app/src/main/assets/gesture.yml app/src/main/assets/gesture.mgs
+
+#include "gesture-set.h"
+#include "mapped-file.h"
+#include <cstdio>
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <gesture.yml> <gesture.mgs>\n", argv[0]);
+        return 2;
+    }
+    const char *inputPath = argv[1];
+    const char *outputPath = argv[2];
+
+    MappedFile input;
+    if (!input.open(inputPath)) {
+        std::fprintf(stderr, "Cannot read %s.\n", inputPath);
+        return 1;
+    }
+    std::vector<Gesture> gestures;
+    DetectionParameters detection;
+    if (!parseGestureDefinitions(input.data(), input.length(), inputPath, gestures, &detection)) {
+        return 1;
+    }
+    std::vector<uint8_t> image = GestureSet::compile(
+            gestures, detection, gestureSourceHash(input.data(), input.length()));
+    if (image.empty()) {
+        return 1;
+    }
+
+    FILE *output = std::fopen(outputPath, "wb");
+    if (output == nullptr || std::fwrite(image.data(), 1, image.size(), output) != image.size()) {
+        std::fprintf(stderr, "Cannot write %s.\n", outputPath);
+        return 1;
+    }
+    std::fclose(output);
+
+    // Load the result the way motion-lib does to make sure it is usable.
+    MappedFile written;
+    GestureSet gestureSet;
+    if (!written.open(outputPath) ||
+        !gestureSet.view(written.data(), written.length(), outputPath) ||
+        gestureSet.size() != (int) gestures.size()) {
+        std::fprintf(stderr, "Verification of %s failed.\n", outputPath);
+        return 1;
+    }
+
+    std::printf("Compiled %d gestures into %s (%zu bytes).\n",
+                gestureSet.size(), outputPath, image.size());
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstddef>
+
+// A read-only memory mapping of a whole file, the host-side counterpart of
+// AAsset_getBuffer().
+class MappedFile {
+    void *address = MAP_FAILED;
+    size_t size = 0;
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const char *path) {
+        close();
+
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            size = (size_t) status.st_size;
+            address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        return address != MAP_FAILED;
+    }
+
+    void close() {
+        if (address != MAP_FAILED) {
+            munmap(address, size);
+        }
+        address = MAP_FAILED;
+        size = 0;
+    }
+
+    const char *data() const {
+        return static_cast<const char *>(address);
+    }
+
+    size_t length() const {
+        return size;
+    }
+};
+
+#endif // MAPPED_FILE_H
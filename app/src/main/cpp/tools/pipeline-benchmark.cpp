@@ -0,0 +1,305 @@
+// Benchmarks the recognition pipeline on the host.
+//
+//     pipeline-benchmark [--gestures <gesture.yml|gesture.mgs>] [--samples <samples.csv>]
+//                        [--length <samples>] [--seed <n>]
+//
+// Every combination of history length and gesture set size is driven with a synthetic
+// trace performing random gestures of the set, and with the recorded trace if one is
+// given. Reported per combination:
+//
+//   samples/s      throughput of MotionMan::update(), one sample per update
+//   ns/update      wall time per update, then the median of each stage as measured by
+//                  MotionMan itself (read, movement, gesture)
+//   allocs/sample  heap allocations during the run, per sample; should be 0
+//   misses/update  last-level cache misses of each stage in user space, from a second pass
+//                  with hardware counters around each stage; n/a where perf events are
+//                  not available
+
+#include "sample-file.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> allocationCount{0};
+
+// Every replaced operator new and delete goes through these two. Not inlined, so that GCC
+// sees neither the malloc() behind a new expression nor the free() behind a delete one,
+// and does not take them for mismatched (-Wmismatched-new-delete).
+__attribute__((noinline)) static void *countedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) static void countedRelease(void *p) {
+    std::free(p);
+}
+
+void *operator new(size_t size) {
+    return countedAllocate(size);
+}
+
+void *operator new[](size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void *p) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    countedRelease(p);
+}
+
+// Cache misses of the calling thread in user space, counted only while enabled.
+class CacheMissCounter {
+    int fd = -1;
+
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter &) = delete;
+
+    CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool isAvailable() const {
+        return fd >= 0;
+    }
+
+    void enable() {
+#ifdef __linux__
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void disable() {
+#ifdef __linux__
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    uint64_t read() const {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+#endif
+        return count;
+    }
+};
+
+static std::vector<Gesture> randomGestures(int count, std::mt19937 &random) {
+    std::uniform_int_distribution<int> lengthOf(2, 6);
+    std::uniform_int_distribution<int> directionOf(1, DIRECTION_COUNT - 1);
+    std::vector<Gesture> gestures;
+    for (int i = 0; i < count; ++i) {
+        Gesture gesture;
+        gesture.name = "g" + std::to_string(i);
+        for (int length = lengthOf(random); length > 0; --length) {
+            gesture.directions.push_back(static_cast<Direction>(directionOf(random)));
+        }
+        gestures.push_back(gesture);
+    }
+    return gestures;
+}
+
+// Performs random gestures of the set, with sensor noise that stays below the thresholds.
+static std::vector<AccelerometerReadings> syntheticTrace(const GestureSet &gestureSet,
+                                                         size_t length, std::mt19937 &random) {
+    const int MOVE_LENGTH = 20;
+    const int STILL_LENGTH = QUIESCENT_THRESHOLD + 10;
+    std::uniform_int_distribution<int> gestureOf(0, gestureSet.size() - 1);
+    std::normal_distribution<float> noise(0.0f, 0.2f);
+
+    std::vector<AccelerometerReadings> samples;
+    while (samples.size() < length) {
+        int gestureIndex = gestureOf(random);
+        int count = gestureSet.getDirectionCount(gestureIndex);
+        const uint8_t *directions = gestureSet.getDirectionsNewestFirst(gestureIndex);
+        for (int d = count - 1; d >= 0; --d) {
+            appendSyntheticMove(samples, static_cast<Direction>(directions[d]), 4.0f,
+                                MOVE_LENGTH, STILL_LENGTH);
+        }
+        samples.insert(samples.end(), 3 * STILL_LENGTH, AccelerometerReadings{0, 0, 0});
+    }
+    samples.resize(length);
+    for (AccelerometerReadings &readings : samples) {
+        readings.x += noise(random);
+        readings.y += noise(random);
+        readings.z += noise(random);
+    }
+    return samples;
+}
+
+template<int HistoryLength>
+static void benchmark(const char *traceName, const std::vector<uint8_t> &gestureSetImage,
+                      const std::vector<AccelerometerReadings> &samples) {
+    auto motionMan = std::unique_ptr<BasicMotionMan<HistoryLength>>(
+            new BasicMotionMan<HistoryLength>());
+    motionMan->loadGestureSet(gestureSetImage.data(), gestureSetImage.size(), "<benchmark>");
+    ReplaySource source;
+
+    uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    for (const AccelerometerReadings &readings : samples) {
+        source.next(readings);
+        motionMan->update(source);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    const PipelineLatencies &latencies = motionMan->getLatencies();
+    std::printf("%7d %8d %-9s %12.0f %9.1f %6llu %8llu %7llu %13.4f %6llu",
+                HistoryLength, motionMan->getGestureSet().size(), traceName,
+                samples.size() / seconds, seconds * 1e9 / samples.size(),
+                (unsigned long long) latencies.get(PipelineStage::READ).getPercentile(50),
+                (unsigned long long) latencies.get(PipelineStage::MOVEMENT).getPercentile(50),
+                (unsigned long long) latencies.get(PipelineStage::GESTURE).getPercentile(50),
+                (double) allocations / samples.size(),
+                (unsigned long long) motionMan->getMetrics().get(Metric::GESTURES));
+
+    // Second pass, stage by stage, with a counter enabled around each of them.
+    CacheMissCounter counters[PIPELINE_STAGE_COUNT];
+    if (!counters[0].isAvailable()) {
+        std::printf("  %s\n", "n/a");
+        return;
+    }
+    motionMan.reset(new BasicMotionMan<HistoryLength>());
+    motionMan->loadGestureSet(gestureSetImage.data(), gestureSetImage.size(), "<benchmark>");
+    for (const AccelerometerReadings &readings : samples) {
+        source.next(readings);
+        motionMan->beginUpdate();
+        counters[0].enable();
+        motionMan->readFromAccelerometer(source);
+        counters[0].disable();
+        counters[1].enable();
+        motionMan->detectMovement();
+        counters[1].disable();
+        counters[2].enable();
+        motionMan->detectGesture();
+        counters[2].disable();
+        motionMan->endUpdate();
+    }
+    for (const CacheMissCounter &counter : counters) {
+        std::printf(" %8.4f", (double) counter.read() / samples.size());
+    }
+    std::printf("\n");
+}
+
+template<int HistoryLength>
+static void benchmarkAll(const std::vector<std::vector<uint8_t>> &gestureSetImages,
+                         const std::vector<AccelerometerReadings> &recordedSamples,
+                         size_t length, unsigned seed) {
+    for (const std::vector<uint8_t> &image : gestureSetImages) {
+        GestureSet gestureSet;
+        gestureSet.view(image.data(), image.size(), "<benchmark>");
+        std::mt19937 random(seed);
+        benchmark<HistoryLength>("synthetic", image, syntheticTrace(gestureSet, length, random));
+        if (!recordedSamples.empty()) {
+            benchmark<HistoryLength>("recorded", image, recordedSamples);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *gesturePath = nullptr;
+    const char *samplesPath = nullptr;
+    size_t length = 200000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--gestures") == 0 && i + 1 < argc) {
+            gesturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samplesPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--length") == 0 && i + 1 < argc) {
+            length = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned) std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--gestures <gesture.yml|gesture.mgs>] "
+                                 "[--samples <samples.csv>] [--length <samples>] [--seed <n>]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    if (length == 0) {
+        std::fprintf(stderr, "--length must be positive.\n");
+        return 2;
+    }
+
+    // Every run loads its gesture set again, which would log each of its gestures.
+    hostInfoLogging = false;
+
+    std::vector<std::vector<uint8_t>> gestureSetImages;
+    if (gesturePath != nullptr) {
+        std::vector<uint8_t> image;
+        if (!compileGestureFile(gesturePath, image)) {
+            return 1;
+        }
+        gestureSetImages.push_back(std::move(image));
+    }
+    std::mt19937 random(seed);
+    for (int size : {10, 100, 1000}) {
+        gestureSetImages.push_back(GestureSet::compile(randomGestures(size, random)));
+    }
+
+    std::vector<AccelerometerReadings> recordedSamples;
+    if (samplesPath != nullptr && !readSampleFile(samplesPath, recordedSamples)) {
+        return 1;
+    }
+
+    std::printf("%7s %8s %-9s %12s %9s %6s %8s %7s %13s %6s %8s %8s %8s\n",
+                "history", "gestures", "trace", "samples/s", "ns/update", "read", "movement",
+                "gesture", "allocs/sample", "found", "misses:r", "m", "g");
+    benchmarkAll<32>(gestureSetImages, recordedSamples, length, seed);
+    benchmarkAll<HISTORY_LENGTH>(gestureSetImages, recordedSamples, length, seed);
+    benchmarkAll<256>(gestureSetImages, recordedSamples, length, seed);
+    return 0;
+}
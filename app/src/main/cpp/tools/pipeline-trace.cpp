@@ -0,0 +1,50 @@
+// Replays samples through the pipeline with trace points enabled and writes a Chrome
+// trace of every update, for chrome://tracing or https://ui.perfetto.dev.
+//
+//     pipeline-trace <gesture.yml|gesture.mgs> <samples.csv|-> <trace.json>
+//
+// With `-` instead of a sample file, every gesture of the set is performed once.
+
+#ifndef MOTION_TRACE
+#error "pipeline-trace must be built with MOTION_TRACE defined."
+#endif
+
+#include "sample-file.h"
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        std::fprintf(stderr, "Usage: %s <gesture.yml|gesture.mgs> <samples.csv|-> <trace.json>\n",
+                     argv[0]);
+        return 2;
+    }
+
+    MappedFile gestureFile;
+    MotionMan motionMan;
+    if (!loadGestureFile(motionMan, gestureFile, argv[1])) {
+        return 1;
+    }
+
+    std::vector<AccelerometerReadings> samples;
+    if (std::strcmp(argv[2], "-") == 0) {
+        synthesizeGestures(motionMan.getGestureSet(), samples);
+    } else if (!readSampleFile(argv[2], samples)) {
+        return 1;
+    }
+
+    ReplaySource source;
+    for (const AccelerometerReadings &readings : samples) {
+        source.next(readings);
+        motionMan.update(source);
+    }
+
+    if (!TraceRegistry::instance().exportChromeTrace(argv[3])) {
+        std::fprintf(stderr, "Cannot write %s.\n", argv[3]);
+        return 1;
+    }
+    std::printf("Replayed %zu samples. The trace keeps the last %d trace points of each "
+                "thread.\n\n", samples.size(), TraceBuffer::CAPACITY);
+    motionMan.getMetrics().dump(stdout);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#ifndef SAMPLE_FILE_H
+#define SAMPLE_FILE_H
+
+// Accelerometer samples for replaying the pipeline on the host.
+//
+// A sample file has one `x,y,z` line of linear acceleration (m/s²) per update, as
+// delivered by the sensor at UPDATE_RATE_HZ. Empty lines and lines starting with `#`
+// are skipped, except for labels of a labeled recording:
+//
+//     #label <gesture name>
+//
+// placed right after the last sample of the gesture's final move.
+
+#include "motion-man.h"
+#include "mapped-file.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct SampleLabel {
+    size_t sample; // Number of samples before the label.
+    std::string gesture;
+};
+
+inline bool readSampleFile(const char *path, std::vector<AccelerometerReadings> &samples,
+                           std::vector<SampleLabel> *labels = nullptr) {
+    FILE *file = std::fopen(path, "r");
+    if (file == nullptr) {
+        std::fprintf(stderr, "Cannot read %s.\n", path);
+        return false;
+    }
+    char line[256];
+    int lineNumber = 0;
+    bool valid = true;
+    while (valid && std::fgets(line, sizeof(line), file) != nullptr) {
+        ++lineNumber;
+        if (labels != nullptr && std::strncmp(line, "#label ", 7) == 0) {
+            std::string gesture(line + 7);
+            while (!gesture.empty() && std::isspace((unsigned char) gesture.back())) {
+                gesture.pop_back();
+            }
+            labels->push_back({samples.size(), gesture});
+            continue;
+        }
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+        AccelerometerReadings readings;
+        if (std::sscanf(line, "%f,%f,%f", &readings.x, &readings.y, &readings.z) != 3) {
+            std::fprintf(stderr, "%s:%d: expected x,y,z.\n", path, lineNumber);
+            valid = false;
+        }
+        samples.push_back(readings);
+    }
+    std::fclose(file);
+    return valid;
+}
+
+inline bool writeSampleFile(const char *path, const std::vector<AccelerometerReadings> &samples) {
+    FILE *file = std::fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    for (const AccelerometerReadings &readings : samples) {
+        std::fprintf(file, "%g,%g,%g\n", readings.x, readings.y, readings.z);
+    }
+    return std::fclose(file) == 0;
+}
+
+// Feeds the samples of one update, usually a single one like the sensor does.
+class ReplaySource : public AccelerometerSource {
+    const AccelerometerReadings *samples = nullptr;
+    int remaining = 0;
+
+public:
+    void next(const AccelerometerReadings &readings) {
+        next(&readings, 1);
+    }
+
+    void next(const AccelerometerReadings *readings, int count) {
+        samples = readings;
+        remaining = count;
+    }
+
+    bool nextReadings(AccelerometerReadings &readings) override {
+        if (remaining == 0) {
+            return false;
+        }
+        readings = *samples++;
+        --remaining;
+        return true;
+    }
+};
+
+// Loads a compiled gesture set in place, or compiles gesture.yml. `file` must outlive
+// `motionMan`.
+template<int HistoryLength>
+bool loadGestureFile(BasicMotionMan<HistoryLength> &motionMan, MappedFile &file, const char *path) {
+    if (!file.open(path)) {
+        std::fprintf(stderr, "Cannot read %s.\n", path);
+        return false;
+    }
+    size_t length = std::strlen(path);
+    if (length > 4 && std::strcmp(path + length - 4, ".mgs") == 0) {
+        return motionMan.loadGestureSet(file.data(), file.length(), path);
+    }
+    motionMan.readGestureDefinitions(file.data(), file.length(), path);
+    return motionMan.getGestureSet().size() > 0;
+}
+
+// Reads a compiled gesture set, or compiles gesture.yml, into an image which any number
+// of recognizers may then use in place with loadGestureSet().
+inline bool compileGestureFile(const char *path, std::vector<uint8_t> &image) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::fprintf(stderr, "Cannot read %s.\n", path);
+        return false;
+    }
+    size_t length = std::strlen(path);
+    if (length > 4 && std::strcmp(path + length - 4, ".mgs") == 0) {
+        image.assign(file.data(), file.data() + file.length());
+        GestureSet gestureSet;
+        return gestureSet.view(image.data(), image.size(), path);
+    }
+    std::vector<Gesture> gestures;
+    DetectionParameters detection;
+    if (!parseGestureDefinitions(file.data(), file.length(), path, gestures, &detection)) {
+        return false;
+    }
+    image = GestureSet::compile(gestures, detection);
+    return !image.empty();
+}
+
+// Appends a clean move: `moveLength` samples accelerating along the direction, then
+// enough stillness for the move to be recognized.
+inline void appendSyntheticMove(std::vector<AccelerometerReadings> &samples, Direction direction,
+                                float acceleration, int moveLength, int stillLength) {
+    AccelerometerReadings move = {0, 0, 0};
+    switch (direction) {
+        case Direction::LEFT:
+            move.x = -acceleration;
+            break;
+        case Direction::RIGHT:
+            move.x = acceleration;
+            break;
+        case Direction::BACKWARD:
+            move.y = -acceleration;
+            break;
+        case Direction::FORWARD:
+            move.y = acceleration;
+            break;
+        case Direction::DOWN:
+            move.z = -acceleration;
+            break;
+        case Direction::UP:
+            move.z = acceleration;
+            break;
+        case Direction::STILL:
+            break;
+    }
+    samples.insert(samples.end(), moveLength, move);
+    samples.insert(samples.end(), stillLength, AccelerometerReadings{0, 0, 0});
+}
+
+// Performs every gesture of a set once, in definition order, labeling each of them if
+// `labels` is given.
+inline void synthesizeGestures(const GestureSet &gestureSet,
+                               std::vector<AccelerometerReadings> &samples,
+                               std::vector<SampleLabel> *labels = nullptr) {
+    const int MOVE_LENGTH = 20;
+    const int STILL_LENGTH = 2 * QUIESCENT_THRESHOLD + 20;
+    samples.insert(samples.end(), STILL_LENGTH, AccelerometerReadings{0, 0, 0});
+    for (int i = 0; i < gestureSet.size(); ++i) {
+        int count = gestureSet.getDirectionCount(i);
+        const uint8_t *directions = gestureSet.getDirectionsNewestFirst(i);
+        for (int d = count - 1; d >= 0; --d) {
+            appendSyntheticMove(samples, static_cast<Direction>(directions[d]), 4.0f,
+                                MOVE_LENGTH, d == 0 ? 0 : STILL_LENGTH);
+        }
+        if (labels != nullptr) {
+            labels->push_back({samples.size(), std::string(gestureSet.getName(i))});
+        }
+        samples.insert(samples.end(), 5 * STILL_LENGTH, AccelerometerReadings{0, 0, 0});
+    }
+}
+
+#endif // SAMPLE_FILE_H
@@ -0,0 +1,309 @@
+// Compares loading gesture definitions from a buffer in place with loading them
+// through a std::istream, the way they were read before YAML::Load(ptr, len).
+// Also reports the heap allocations of a load and the peak of heap memory in use while
+// loading, document included, and the throughput of parsing alone: scanning the tokens
+// and reporting the events of the document without building it. Last, compares loading
+// the document in place with parseGestureDefinitions(), which reads the gestures from the
+// events, with its logging of every gesture turned off. Then times as<T>() and encoding on
+// a document of numbers, against the stringstream conversions which convert.h falls
+// back to.
+//
+//     yaml-load-benchmark [gesture count] [repetitions]
+
+#include "gesture-set.h"
+#include "yaml-cpp/eventhandler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every block is prefixed with its size so that the bytes in use can be tracked.
+static const size_t ALLOCATION_HEADER = alignof(std::max_align_t);
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<int64_t> bytesInUse{0};
+static std::atomic<int64_t> peakBytesInUse{0};
+
+// Every replaced operator new and delete goes through these two, which are not inlined and
+// step over the header as integers, so that GCC neither pairs malloc() and free() with new
+// and delete expressions (-Wmismatched-new-delete) nor takes the header for outside the
+// object a pointer was returned for (-Warray-bounds).
+__attribute__((noinline)) static void *trackedAllocate(size_t size) {
+    void *block = std::malloc(size + ALLOCATION_HEADER);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t *>(block) = size;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    int64_t inUse = bytesInUse.fetch_add(size, std::memory_order_relaxed) + (int64_t) size;
+    if (inUse > peakBytesInUse.load(std::memory_order_relaxed)) {
+        peakBytesInUse.store(inUse, std::memory_order_relaxed);
+    }
+    return reinterpret_cast<void *>(reinterpret_cast<std::uintptr_t>(block) + ALLOCATION_HEADER);
+}
+
+__attribute__((noinline)) static void trackedRelease(void *p) {
+    if (p != nullptr) {
+        void *block = reinterpret_cast<void *>(reinterpret_cast<std::uintptr_t>(p) -
+                                               ALLOCATION_HEADER);
+        bytesInUse.fetch_sub(*static_cast<size_t *>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+void *operator new(size_t size) {
+    return trackedAllocate(size);
+}
+
+void *operator new[](size_t size) {
+    return trackedAllocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete[](void *p) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    trackedRelease(p);
+}
+
+struct LoadCost {
+    double ms;
+    uint64_t allocations; // Of the last repetition.
+    int64_t peakBytes;    // Above what was in use before the last repetition.
+};
+
+static std::string generateGestureDefinitions(int gestureCount) {
+    static const char DIRECTIONS[] = "LRUDFB";
+    std::string source = "# Generated by yaml-load-benchmark.\n\n";
+    for (int i = 0; i < gestureCount; ++i) {
+        source += "- [手势";
+        source += std::to_string(i);
+        source += ", ";
+        for (int n = i, d = 0; d < 2 + i % 5; ++d, n /= 6) {
+            source += DIRECTIONS[n % 6];
+        }
+        source += "]\n";
+    }
+    return source;
+}
+
+// As many rows of an integer, a hexadecimal integer and a double.
+static std::string generateNumbers(int rowCount) {
+    std::string source = "# Generated by yaml-load-benchmark.\n\n";
+    char row[96];
+    for (int i = 0; i < rowCount; ++i) {
+        std::snprintf(row, sizeof(row), "- [%d, %#x, %.*g]\n", i * 7919 - 5000000, i * 2654435761u,
+                      3 + i % 15, i * 0.6180339887498949 - 1000.0);
+        source += row;
+    }
+    return source;
+}
+
+// Reads every number of generateNumbers() with `read`, as as<T>() does, then writes them
+// back with `write`, as convert<T>::encode() does.
+template<typename Read, typename Write>
+static double bestConversionMs(int repetitions, const YAML::Node &rows, Read read, Write write) {
+    double best = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        double sum = 0;
+        size_t length = 0;
+        for (const YAML::Node &row : rows) {
+            int integer;
+            unsigned hexadecimal;
+            double real;
+            if (!read(row[0].Scalar(), integer) || !read(row[1].Scalar(), hexadecimal) ||
+                !read(row[2].Scalar(), real)) {
+                std::printf("Could not read %s.\n", row[0].Scalar().c_str());
+                std::exit(1);
+            }
+            sum += integer + hexadecimal + real;
+            length += write(integer).size() + write(hexadecimal).size() + write(real).size();
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count();
+        if (sum == 0 || length == 0) {
+            std::exit(1);
+        }
+        if (i == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+struct StreamRead {
+    template<typename T>
+    bool operator()(const std::string &input, T &rhs) const {
+        return YAML::conversion::ReadNumber<T>(input, rhs);
+    }
+};
+
+struct StreamWrite {
+    template<typename T>
+    std::string operator()(const T &rhs) const {
+        return YAML::conversion::WriteNumber<T>(rhs);
+    }
+};
+
+struct ConvertRead {
+    template<typename T>
+    bool operator()(const std::string &input, T &rhs) const {
+        return YAML::conversion::DecodeStreamable(input, rhs);
+    }
+};
+
+struct ConvertWrite {
+    template<typename T>
+    std::string operator()(const T &rhs) const {
+        return YAML::conversion::WriteNumber(rhs);
+    }
+};
+
+// Counts the scalars of a document and drops everything else.
+class ScalarCounter : public YAML::EventHandler {
+public:
+    size_t scalars = 0;
+
+    void OnDocumentStart(const YAML::Mark &) override {}
+
+    void OnDocumentEnd() override {}
+
+    void OnNull(const YAML::Mark &, YAML::anchor_t) override {}
+
+    void OnAlias(const YAML::Mark &, YAML::anchor_t) override {}
+
+    void OnScalar(const YAML::Mark &, const std::string &, YAML::anchor_t,
+                  const std::string &) override {
+        ++scalars;
+    }
+
+    void OnSequenceStart(const YAML::Mark &, const std::string &, YAML::anchor_t,
+                         YAML::EmitterStyle::value) override {}
+
+    void OnSequenceEnd() override {}
+
+    void OnMapStart(const YAML::Mark &, const std::string &, YAML::anchor_t,
+                    YAML::EmitterStyle::value) override {}
+
+    void OnMapEnd() override {}
+};
+
+static double bestParseMs(int repetitions, size_t expectedScalars, const std::string &source) {
+    double best = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        std::stringstream stream(source);
+        YAML::Parser parser(stream);
+        ScalarCounter counter;
+        while (parser.HandleNextDocument(counter)) {
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count();
+        if (counter.scalars != expectedScalars) {
+            std::fprintf(stderr, "Parsed %zu scalars, expected %zu.\n", counter.scalars,
+                         expectedScalars);
+            std::exit(1);
+        }
+        if (i == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+static size_t loadedSize(const YAML::Node &node) {
+    return node.size();
+}
+
+static size_t loadedSize(const std::vector<Gesture> &gestures) {
+    return gestures.size();
+}
+
+template<typename Load>
+static LoadCost bestOf(int repetitions, size_t expectedSize, Load load) {
+    LoadCost cost = {0, 0, 0};
+    for (int i = 0; i < repetitions; ++i) {
+        uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        int64_t bytesBefore = bytesInUse.load(std::memory_order_relaxed);
+        peakBytesInUse.store(bytesBefore, std::memory_order_relaxed);
+        auto begin = std::chrono::steady_clock::now();
+        auto loaded = load();
+        auto end = std::chrono::steady_clock::now();
+        cost.allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        cost.peakBytes = peakBytesInUse.load(std::memory_order_relaxed) - bytesBefore;
+        if (loadedSize(loaded) != expectedSize) {
+            std::printf("Loaded %zu gestures, expected %zu.\n", loadedSize(loaded), expectedSize);
+            std::exit(1);
+        }
+        double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        if (i == 0 || ms < cost.ms) {
+            cost.ms = ms;
+        }
+    }
+    return cost;
+}
+
+int main(int argc, char *argv[]) {
+    int gestureCount = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (gestureCount <= 0 || repetitions <= 0) {
+        std::fprintf(stderr, "Usage: %s [gesture count] [repetitions]\n", argv[0]);
+        return 2;
+    }
+
+    hostInfoLogging = false;
+
+    std::string source = generateGestureDefinitions(gestureCount);
+    size_t expectedSize = static_cast<size_t>(gestureCount);
+
+    LoadCost stream = bestOf(repetitions, expectedSize, [&source]() {
+        std::string copy(source);
+        std::stringstream stream(copy);
+        return YAML::Load(stream);
+    });
+    LoadCost buffer = bestOf(repetitions, expectedSize, [&source]() {
+        return YAML::Load(source.data(), source.size());
+    });
+
+    double parseMs = bestParseMs(repetitions, 2 * expectedSize, source);
+
+    LoadCost gestureEvents = bestOf(repetitions, expectedSize, [&source]() {
+        std::vector<Gesture> gestures;
+        parseGestureDefinitions(source.data(), source.size(), "<generated>", gestures);
+        return gestures;
+    });
+
+    const YAML::Node numbers = YAML::Load(generateNumbers(gestureCount));
+    double streamNumbersMs = bestConversionMs(repetitions, numbers, StreamRead(), StreamWrite());
+    double numbersMs = bestConversionMs(repetitions, numbers, ConvertRead(), ConvertWrite());
+
+    std::printf("%d gestures, %zu bytes, best of %d\n", gestureCount, source.size(), repetitions);
+    std::printf("  istream copy  %10.3f ms  %9llu allocations  %9.1f KiB peak\n", stream.ms,
+                (unsigned long long) stream.allocations, stream.peakBytes / 1024.0);
+    std::printf("  in place      %10.3f ms  %9llu allocations  %9.1f KiB peak  (%.2fx)\n",
+                buffer.ms, (unsigned long long) buffer.allocations, buffer.peakBytes / 1024.0,
+                stream.ms / buffer.ms);
+    std::printf("  events only   %10.3f ms  %9.1f MB/s\n", parseMs,
+                source.size() / parseMs / 1000.0);
+    std::printf("  gestures      %10.3f ms  %9llu allocations  %9.1f KiB peak\n",
+                gestureEvents.ms, (unsigned long long) gestureEvents.allocations,
+                gestureEvents.peakBytes / 1024.0);
+    std::printf("%d rows of 3 numbers, read and written\n", gestureCount);
+    std::printf("  stringstream  %10.3f ms\n", streamNumbersMs);
+    std::printf("  convert<T>    %10.3f ms  (%.2fx)\n", numbersMs, streamNumbersMs / numbersMs);
+    return 0;
+}
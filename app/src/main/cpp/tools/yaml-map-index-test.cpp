@@ -0,0 +1,83 @@
+// Checks that lookups in the key index of large yaml-cpp maps find what a scan of the map
+// would, also after key nodes were changed in place.
+//
+//     yaml-map-index-test
+
+#include "yaml-cpp/yaml.h"
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+// A map large enough to be indexed, k0: 0 to k<count - 1>: <count - 1>.
+static YAML::Node largeMap(int count) {
+    YAML::Node map(YAML::NodeType::Map);
+    for (int i = 0; i < count; ++i) {
+        map["k" + std::to_string(i)] = i;
+    }
+    return map;
+}
+
+static void keyRenamedAfterIndexing() {
+    YAML::Node map = largeMap(20);
+    check(map[std::string("k3")].as<int>() == 3, "k3 is found before renaming");
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->first.as<std::string>() == "k3") {
+            it->first = "zz";
+        }
+    }
+
+    const YAML::Node &constMap = map;
+    check(constMap[std::string("zz")].IsDefined(), "renamed key is found by a const lookup");
+    check(constMap[std::string("zz")].as<int>() == 3, "renamed key keeps its value");
+    check(!constMap[std::string("k3")].IsDefined(), "old name of a renamed key is not found");
+    check(map[std::string("zz")].as<int>() == 3, "renamed key is found by a lookup");
+    check(map.size() == 20, "looking the renamed key up inserts nothing");
+    check(constMap[std::string("k4")].as<int>() == 4, "other keys are still found");
+}
+
+static void nullKeyAssignedAfterIndexing() {
+    YAML::Node map = largeMap(20);
+    map[YAML::Node(YAML::NodeType::Null)] = "value";
+    const YAML::Node &constMap = map;
+    check(!constMap[std::string("late")].IsDefined(), "late is not a key yet");
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->first.IsNull()) {
+            it->first = "late";
+        }
+    }
+
+    check(constMap[std::string("late")].IsDefined(), "key assigned a scalar is found");
+    check(constMap[std::string("late")].as<std::string>() == "value",
+          "key assigned a scalar keeps its value");
+}
+
+static void newKeysAfterIndexing() {
+    YAML::Node map = largeMap(20);
+    check(map[std::string("k19")].as<int>() == 19, "k19 is found");
+    map["added"] = 42;
+    const YAML::Node &constMap = map;
+    check(constMap[std::string("added")].as<int>() == 42, "key added after indexing is found");
+    map.remove(std::string("k0"));
+    check(!constMap[std::string("k0")].IsDefined(), "removed key is not found");
+    check(constMap[std::string("k1")].as<int>() == 1, "keys after a removed one are found");
+}
+
+int main() {
+    keyRenamedAfterIndexing();
+    nullKeyAssignedAfterIndexing();
+    newKeysAfterIndexing();
+    if (failures != 0) {
+        std::printf("%d checks failed.\n", failures);
+        return 1;
+    }
+    std::printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,174 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped trace points for looking inside the pipeline on host replay runs.
+// Nothing in here may depend on Android or JNI headers.
+//
+//     void detectGesture() {
+//         TRACE_SCOPE("detectGesture");
+//         ...
+//     }
+//
+// Trace points compile to nothing unless MOTION_TRACE is defined. When it is, each one
+// appends a begin/end record to a ring owned by the calling thread, the oldest records
+// being overwritten once the ring is full. TraceRegistry::exportChromeTrace() writes
+// every ring as Chrome Trace Event JSON, for chrome://tracing or https://ui.perfetto.dev.
+
+#ifdef MOTION_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// A raw timestamp, as cheap as the platform allows. Converted to nanoseconds on export.
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+struct TraceRecord {
+    const char *name; // A string literal.
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Records of one thread. Only the owning thread writes; export reads `count` with
+// acquire ordering, so records are complete once counted.
+class TraceBuffer {
+public:
+    const static int CAPACITY = 1 << 16;
+
+private:
+    TraceRecord records[CAPACITY];
+    std::atomic<uint64_t> count{0};
+    const int threadIndex;
+
+public:
+    explicit TraceBuffer(int threadIndex) : threadIndex(threadIndex) {}
+
+    void append(const char *name, uint64_t begin, uint64_t end) {
+        uint64_t n = count.load(std::memory_order_relaxed);
+        records[n % CAPACITY] = {name, begin, end};
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    int getThreadIndex() const {
+        return threadIndex;
+    }
+
+    uint64_t getCount() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+    // Valid for the last CAPACITY records only.
+    const TraceRecord &get(uint64_t index) const {
+        return records[index % CAPACITY];
+    }
+};
+
+// Owns the buffers of every thread that ever hit a trace point; they outlive their threads
+// so that traces may be exported after worker threads are gone.
+class TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    const uint64_t originTicks = traceTicks();
+    const std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+
+    TraceRegistry() = default;
+
+public:
+    static TraceRegistry &instance() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    // The buffer of the calling thread. The lock is only taken on the first call.
+    static TraceBuffer &current() {
+        thread_local TraceBuffer *buffer = nullptr;
+        if (buffer == nullptr) {
+            TraceRegistry &registry = instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.emplace_back(new TraceBuffer((int) registry.buffers.size() + 1));
+            buffer = registry.buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    // Call while no trace point is running, e.g. at the end of a replay.
+    bool exportChromeTrace(const char *path) {
+        // Calibrate ticks against the steady clock over the lifetime of the registry.
+        uint64_t ticks = traceTicks() - originTicks;
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - originTime).count();
+        double microsecondsPerTick = ticks > 0 ? nanoseconds / 1000.0 / ticks : 0.0;
+
+        FILE *file = std::fopen(path, "w");
+        if (file == nullptr) {
+            return false;
+        }
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+        bool first = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &buffer : buffers) {
+            uint64_t count = buffer->getCount();
+            uint64_t begin = count > TraceBuffer::CAPACITY ? count - TraceBuffer::CAPACITY : 0;
+            for (uint64_t i = begin; i < count; ++i) {
+                const TraceRecord &record = buffer->get(i);
+                std::fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                                   "\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",", record.name, buffer->getThreadIndex(),
+                             (double) (int64_t) (record.begin - originTicks) * microsecondsPerTick,
+                             (double) (record.end - record.begin) * microsecondsPerTick);
+                first = false;
+            }
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+};
+
+class TraceScope {
+    TraceBuffer &buffer;
+    const char *const name;
+    const uint64_t begin;
+
+public:
+    explicit TraceScope(const char *name)
+            : buffer(TraceRegistry::current()), name(name), begin(traceTicks()) {}
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    ~TraceScope() {
+        buffer.append(name, begin, traceTicks());
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void) 0)
+
+#endif // MOTION_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,14 @@
+package net.qfstudio.motion;
+
+/**
+ * Mirrors `enum struct Direction` in motion-types.h; ordinals are shared with native code.
+ */
+public enum Direction {
+    STILL, LEFT, RIGHT, UP, DOWN, FORWARD, BACKWARD;
+
+    private static final Direction[] VALUES = values();
+
+    public static Direction fromOrdinal(int ordinal) {
+        return VALUES[ordinal];
+    }
+}
@@ -0,0 +1,76 @@
+package net.qfstudio.motion;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * A batch of events delivered by the native library in a single call.
+ * <p>
+ * The batch is a view over a native buffer which is reused for the next batch,
+ * so it must not be retained after the handler returns.
+ */
+public class MotionEventBatch {
+    public static final int TYPE_DIRECTION_CHANGE = 0;
+    public static final int TYPE_MOVEMENT_DETECTED = 1;
+    public static final int TYPE_GESTURE_DETECTED = 2;
+
+    // Layout of `struct MotionEvent` in motion-types.h.
+    private static final int EVENT_SIZE = 8;
+    private static final int TYPE_OFFSET = 0;
+    private static final int CODE_OFFSET = 4;
+
+    private final ByteBuffer buffer;
+    private final String[] directionLabels;
+    private final String[] movementLabels;
+    private final String[] gestureNames;
+    private int size = 0;
+
+    MotionEventBatch(ByteBuffer buffer, String[] directionLabels, String[] movementLabels,
+                     String[] gestureNames) {
+        this.buffer = buffer.order(ByteOrder.nativeOrder());
+        this.directionLabels = directionLabels;
+        this.movementLabels = movementLabels;
+        this.gestureNames = gestureNames;
+    }
+
+    void setSize(int size) {
+        this.size = size;
+    }
+
+    public int size() {
+        return size;
+    }
+
+    public int getType(int index) {
+        return buffer.getInt(index * EVENT_SIZE + TYPE_OFFSET);
+    }
+
+    /**
+     * @return the direction ordinal for direction and movement events,
+     * or the gesture id for gesture events.
+     */
+    public int getCode(int index) {
+        return buffer.getInt(index * EVENT_SIZE + CODE_OFFSET);
+    }
+
+    /**
+     * @return the direction of a direction or movement event.
+     */
+    public Direction getDirection(int index) {
+        return Direction.fromOrdinal(getCode(index));
+    }
+
+    public String getLabel(int index) {
+        int code = getCode(index);
+        switch (getType(index)) {
+            case TYPE_DIRECTION_CHANGE:
+                return directionLabels[code];
+            case TYPE_MOVEMENT_DETECTED:
+                return movementLabels[code];
+            case TYPE_GESTURE_DETECTED:
+                return gestureNames[code];
+            default:
+                return null;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+package net.qfstudio.motion;
+
+import android.os.Build;
+
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Read-only view of the recent samples and events kept by the native library.
+ * <p>
+ * The rings live in native memory shared through direct ByteBuffers, so reading
+ * them needs neither a JNI call nor an allocation. Each read returns a consistent
+ * snapshot; it is retried when the native side writes to the ring meanwhile.
+ */
+public class MotionHistory {
+    // Layout of `struct SharedRing` in shared-ring.h.
+    private static final int SEQUENCE_OFFSET = 0;
+    private static final int CAPACITY_OFFSET = 4;
+    private static final int COUNT_OFFSET = 8;
+    private static final int RECORDS_OFFSET = 16;
+
+    // Layout of `struct AccelerometerReadings` and `struct MotionEvent` in motion-types.h.
+    private static final int SAMPLE_SIZE = 12;
+    private static final int EVENT_SIZE = 8;
+
+    // VarHandle.acquireFence() where the platform has it (API 33). Looked up by name, as the
+    // app is compiled against an older SDK; null below API 33.
+    private static final MethodHandle ACQUIRE_FENCE = findAcquireFence();
+
+    private final ByteBuffer samples;
+    private final ByteBuffer events;
+    private final Object fence = new Object();
+    private int fenceCount = 0;
+
+    MotionHistory(ByteBuffer samples, ByteBuffer events) {
+        this.samples = samples.order(ByteOrder.nativeOrder());
+        this.events = events.order(ByteOrder.nativeOrder());
+    }
+
+    public int getSampleCapacity() {
+        return samples.getInt(CAPACITY_OFFSET);
+    }
+
+    public int getEventCapacity() {
+        return events.getInt(CAPACITY_OFFSET);
+    }
+
+    /**
+     * Copies the most recent filtered samples into {@code out} as x, y, z triples,
+     * oldest first.
+     *
+     * @return the number of samples copied.
+     */
+    public int readSamples(float[] out) {
+        int capacity = getSampleCapacity();
+        while (true) {
+            int sequence = beginRead(samples);
+            long count = samples.getLong(COUNT_OFFSET);
+            int n = (int) Math.min(Math.min(count, capacity), out.length / 3);
+            for (int i = 0; i < n; ++i) {
+                int offset = RECORDS_OFFSET + (int) ((count - n + i) % capacity) * SAMPLE_SIZE;
+                out[i * 3] = samples.getFloat(offset);
+                out[i * 3 + 1] = samples.getFloat(offset + 4);
+                out[i * 3 + 2] = samples.getFloat(offset + 8);
+            }
+            if (endRead(samples, sequence)) {
+                return n;
+            }
+        }
+    }
+
+    /**
+     * Copies the most recent events into {@code types} and {@code codes}, oldest first.
+     * See {@link MotionEventBatch} for the meaning of types and codes.
+     *
+     * @return the number of events copied.
+     */
+    public int readEvents(int[] types, int[] codes) {
+        int capacity = getEventCapacity();
+        while (true) {
+            int sequence = beginRead(events);
+            long count = events.getLong(COUNT_OFFSET);
+            int n = (int) Math.min(Math.min(count, capacity), Math.min(types.length, codes.length));
+            for (int i = 0; i < n; ++i) {
+                int offset = RECORDS_OFFSET + (int) ((count - n + i) % capacity) * EVENT_SIZE;
+                types[i] = events.getInt(offset);
+                codes[i] = events.getInt(offset + 4);
+            }
+            if (endRead(events, sequence)) {
+                return n;
+            }
+        }
+    }
+
+    private int beginRead(ByteBuffer ring) {
+        int sequence;
+        do {
+            sequence = ring.getInt(SEQUENCE_OFFSET);
+        } while ((sequence & 1) != 0);
+        loadFence();
+        return sequence;
+    }
+
+    private boolean endRead(ByteBuffer ring, int sequence) {
+        loadFence();
+        return ring.getInt(SEQUENCE_OFFSET) == sequence;
+    }
+
+    // Orders the plain buffer reads around the sequence checks: an acquire fence, or below
+    // API 33 a monitor, which ART enters and exits with full barriers.
+    private void loadFence() {
+        if (ACQUIRE_FENCE != null) {
+            try {
+                ACQUIRE_FENCE.invokeExact();
+            } catch (Throwable e) {
+                throw new AssertionError(e);
+            }
+            return;
+        }
+        synchronized (fence) {
+            ++fenceCount;
+        }
+    }
+
+    private static MethodHandle findAcquireFence() {
+        if (Build.VERSION.SDK_INT < 33) {
+            return null;
+        }
+        try {
+            return MethodHandles.publicLookup().findStatic(
+                    Class.forName("java.lang.invoke.VarHandle"), "acquireFence",
+                    MethodType.methodType(void.class));
+        } catch (ReflectiveOperationException e) {
+            return null;
+        }
+    }
+}
@@ -1,16 +1,75 @@
 package net.qfstudio.motion;
 
 import android.content.res.AssetManager;
+import android.os.Handler;
 import android.os.Looper;
 
+import java.nio.ByteBuffer;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 
+
+/**
+ * A gesture recognizer running on its own looper thread. Every instance owns
+ * an independent native recognizer, so several of them may run side by side.
+ */
 public class MotionLib {
     static {
         System.loadLibrary("motion-lib");
     }
 
+    // Overflow policies of the native event queue, see `enum struct OverflowPolicy`.
+    public static final int OVERFLOW_DROP_OLDEST = 0;
+    public static final int OVERFLOW_COALESCE_DIRECTION_CHANGES = 1;
+    public static final int OVERFLOW_BLOCK = 2;
+
+    // Subscription mask bits, one per event type of MotionEventBatch.
+    public static final int SUBSCRIBE_DIRECTION_CHANGES = 1 << MotionEventBatch.TYPE_DIRECTION_CHANGE;
+    public static final int SUBSCRIBE_MOVEMENTS = 1 << MotionEventBatch.TYPE_MOVEMENT_DETECTED;
+    public static final int SUBSCRIBE_GESTURES = 1 << MotionEventBatch.TYPE_GESTURE_DETECTED;
+    public static final int SUBSCRIBE_ALL =
+            SUBSCRIBE_DIRECTION_CHANGES | SUBSCRIBE_MOVEMENTS | SUBSCRIBE_GESTURES;
+
+    // Stages of a native update, see `enum struct PipelineStage`.
+    public static final int STAGE_READ = 0;
+    public static final int STAGE_MOVEMENT = 1;
+    public static final int STAGE_GESTURE = 2;
+
+    // Indices into the array returned by getLatencySummary(), see `struct LatencySummary`.
+    public static final int LATENCY_COUNT = 0;
+    public static final int LATENCY_P50_NS = 1;
+    public static final int LATENCY_P99_NS = 2;
+    public static final int LATENCY_P999_NS = 3;
+    public static final int LATENCY_MAX_NS = 4;
+
+    // Indices into the array filled by getMetrics(), see `enum struct Metric`.
+    public static final int METRIC_UPDATES = 0;
+    public static final int METRIC_SAMPLES = 1;
+    public static final int METRIC_DIRECTION_CHANGES = 2;
+    public static final int METRIC_MOVES = 3;
+    public static final int METRIC_GESTURES = 4;
+    public static final int METRIC_DIRECTION_CHANGES_SUPPRESSED = 5;
+    public static final int METRIC_MOVES_SUPPRESSED = 6;
+    public static final int METRIC_GESTURES_SUPPRESSED = 7;
+    public static final int METRIC_SENSOR_CALLBACKS = 8;
+    public static final int METRIC_EVENTS_POSTED = 9;
+    public static final int METRIC_EVENTS_DROPPED = 10;
+    public static final int METRIC_EVENTS_COALESCED = 11;
+    public static final int METRIC_EVENT_BATCHES = 12;
+    public static final int METRIC_EVENTS_DISPATCHED = 13;
+    public static final int METRIC_HANDLER_EXCEPTIONS = 14;
+    public static final int METRIC_EVENT_BACKLOG = 15;
+    public static final int METRIC_EVENT_BACKLOG_MAX = 16;
+    public static final int METRIC_GESTURES_LOADED = 17;
+
     private boolean isInitialized = false;
-    private MotionLibEventHandler handler;
+    private volatile long nativeHandle;
+    // Held shared by every call into the native recognizer, so that release() can wait for
+    // the calls already running before the recognizer is destroyed.
+    private final ReentrantReadWriteLock nativeLock = new ReentrantReadWriteLock();
+    private Looper looper;
+    private volatile MotionLibEventHandler handler;
+    private MotionEventBatch eventBatch;
+    private MotionHistory history;
 
     public MotionLib(final AssetManager assetManager) {
         try {
@@ -20,7 +79,17 @@ public class MotionLib {
                     Looper.prepare();
 
                     synchronized (MotionLib.this) {
-                        initUnderlyingNativeLib(assetManager);
+                        long handle = nativeCreate(assetManager);
+                        MotionLib.this.nativeHandle = handle;
+                        MotionLib.this.looper = Looper.myLooper();
+                        MotionLib.this.eventBatch = new MotionEventBatch(
+                                nativeGetEventBatchBuffer(handle),
+                                nativeGetDirectionLabels(handle),
+                                nativeGetMovementLabels(handle),
+                                nativeGetGestureNames(handle));
+                        MotionLib.this.history = new MotionHistory(
+                                nativeGetSampleHistoryBuffer(handle),
+                                nativeGetEventHistoryBuffer(handle));
                         MotionLib.this.isInitialized = true;
                         MotionLib.this.notifyAll();
                     }
@@ -38,41 +107,367 @@ public class MotionLib {
         }
     }
 
+    /**
+     * Sets the handler receiving recognition events. Handlers are invoked on a dedicated
+     * dispatcher thread, never on the sensor thread, so they may take their time.
+     */
     public void setHandler(MotionLibEventHandler handler) {
         this.handler = handler;
     }
 
-    private native void initUnderlyingNativeLib(AssetManager assetManager);
+    /**
+     * Selects the event types delivered to the handler and recorded in the event history.
+     * Unsubscribed events are not produced at all. Defaults to {@link #SUBSCRIBE_ALL}.
+     */
+    public void setSubscriptions(int mask) {
+        long handle = enterNative();
+        try {
+            nativeSetSubscriptions(handle, mask);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * @param eventType one of the {@code TYPE_*} constants of {@link MotionEventBatch}.
+     * @return how many events of that type were skipped because it was not subscribed.
+     */
+    public long getSuppressedEventCount(int eventType) {
+        long handle = enterNative();
+        try {
+            return nativeGetSuppressedEventCount(handle, eventType);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * Chooses what happens to new events while the handler is too slow to keep up.
+     * Defaults to {@link #OVERFLOW_DROP_OLDEST}.
+     */
+    public void setOverflowPolicy(int policy) {
+        long handle = enterNative();
+        try {
+            nativeSetOverflowPolicy(handle, policy);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * @param stage one of the {@code STAGE_*} constants.
+     * @return how long that stage of an update takes, indexed by the {@code LATENCY_*}
+     * constants. Durations are in nanoseconds and accurate to about 6%.
+     */
+    public long[] getLatencySummary(int stage) {
+        long handle = enterNative();
+        try {
+            return nativeGetLatencySummary(handle, stage);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * Copies the counters and gauges of this recognizer, indexed by the {@code METRIC_*}
+     * constants, in a single call. Allocation-free, so it may be polled.
+     *
+     * @param values receives as many metrics as it has room for.
+     * @return the number of metrics the library provides, which may exceed
+     * {@code values.length}.
+     */
+    public int getMetrics(long[] values) {
+        long handle = enterNative();
+        try {
+            return nativeGetMetrics(handle, values);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * @return telemetry names of the metrics, in the order of {@link #getMetrics(long[])}.
+     */
+    public static String[] getMetricNames() {
+        return nativeGetMetricNames();
+    }
+
+    /**
+     * Writes the last 30 seconds of samples and recognition decisions to a file, for
+     * decoding and replay with the host tool {@code flight-decoder}. May be called from
+     * any thread, e.g. when the user reports a missed gesture.
+     *
+     * @return whether the file was written.
+     */
+    public boolean dumpFlightRecorder(String path) {
+        long handle = enterNative();
+        try {
+            return nativeDumpFlightRecorder(handle, path);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * Writes the latencies of every stage to the log.
+     */
+    public void dumpLatencies() {
+        long handle = enterNative();
+        try {
+            nativeDumpLatencies(handle);
+        } finally {
+            exitNative();
+        }
+    }
+
+    /**
+     * Stops the sensor and frees the native recognizer, once the calls already running on
+     * other threads have returned. Every other method but {@link #setHandler} throws
+     * {@link IllegalStateException} afterwards, and the history must no longer be read.
+     */
+    public void release() {
+        final long handle;
+        nativeLock.writeLock().lock();
+        try {
+            handle = this.nativeHandle;
+            this.nativeHandle = 0;
+        } finally {
+            nativeLock.writeLock().unlock();
+        }
+        if (handle == 0) {
+            return;
+        }
+
+        new Handler(this.looper).post(new Runnable() {
+            @Override
+            public void run() {
+                nativeDestroy(handle);
+                Looper.myLooper().quit();
+            }
+        });
+    }
+
+    /**
+     * @return the recent samples and events, readable from any thread without JNI calls.
+     */
+    public MotionHistory getHistory() {
+        if (nativeHandle == 0) {
+            throw new IllegalStateException("MotionLib has been released.");
+        }
+        return history;
+    }
+
+    // Returns the handle of the native recognizer, which stays valid until exitNative().
+    private long enterNative() {
+        nativeLock.readLock().lock();
+        long handle = nativeHandle;
+        if (handle == 0) {
+            nativeLock.readLock().unlock();
+            throw new IllegalStateException("MotionLib has been released.");
+        }
+        return handle;
+    }
+
+    private void exitNative() {
+        nativeLock.readLock().unlock();
+    }
+
+    public void resume() {
+        long handle = enterNative();
+        try {
+            nativeResume(handle);
+        } finally {
+            exitNative();
+        }
+    }
+
+    public void pause() {
+        long handle = enterNative();
+        try {
+            nativePause(handle);
+        } finally {
+            exitNative();
+        }
+    }
+
+    public void update() {
+        long handle = enterNative();
+        try {
+            nativeUpdate(handle);
+        } finally {
+            exitNative();
+        }
+    }
+
+    public float[] getLastMeterReadings() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastMeterReadings(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native void resume();
+    public String getLastDirection() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastDirection(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native void pause();
+    public String getLastMovement() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastMovement(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native void update();
+    public String getLastGesture() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastGesture(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native float[] getLastMeterReadings();
+    public int getLastDirectionOrdinal() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastDirectionOrdinal(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native String getLastDirection();
+    public int getLastMovementOrdinal() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastMovementOrdinal(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native String getLastMovement();
+    /**
+     * @return index of the last recognized gesture in {@link #getGestureNames()}, or -1.
+     */
+    public int getLastGestureId() {
+        long handle = enterNative();
+        try {
+            return nativeGetLastGestureId(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    public native String getLastGesture();
+    public String[] getDirectionLabels() {
+        long handle = enterNative();
+        try {
+            return nativeGetDirectionLabels(handle);
+        } finally {
+            exitNative();
+        }
+    }
 
-    private void handleDirectionChange(String direction) {
-        if (this.handler != null) {
-            handler.onDirectionChanged(direction);
+    public String[] getMovementLabels() {
+        long handle = enterNative();
+        try {
+            return nativeGetMovementLabels(handle);
+        } finally {
+            exitNative();
         }
     }
 
-    private void handleMovementDetected(String movement) {
-        if (this.handler != null) {
-            handler.onMovementDetected(movement);
+    public String[] getGestureNames() {
+        long handle = enterNative();
+        try {
+            return nativeGetGestureNames(handle);
+        } finally {
+            exitNative();
         }
     }
 
-    private void handleGestureDetected(String gestureName) {
-        if (this.handler != null) {
-            handler.onGestureDetected(gestureName);
+    private native long nativeCreate(AssetManager assetManager);
+
+    private static native void nativeDestroy(long handle);
+
+    private static native void nativeResume(long handle);
+
+    private static native void nativePause(long handle);
+
+    private static native void nativeUpdate(long handle);
+
+    private static native void nativeSetOverflowPolicy(long handle, int policy);
+
+    private static native void nativeSetSubscriptions(long handle, int mask);
+
+    private static native long nativeGetSuppressedEventCount(long handle, int eventType);
+
+    private static native long[] nativeGetLatencySummary(long handle, int stage);
+
+    private static native void nativeDumpLatencies(long handle);
+
+    private static native int nativeGetMetrics(long handle, long[] values);
+
+    private static native boolean nativeDumpFlightRecorder(long handle, String path);
+
+    private static native String[] nativeGetMetricNames();
+
+    private static native float[] nativeGetLastMeterReadings(long handle);
+
+    private static native String nativeGetLastDirection(long handle);
+
+    private static native String nativeGetLastMovement(long handle);
+
+    private static native String nativeGetLastGesture(long handle);
+
+    private static native int nativeGetLastDirectionOrdinal(long handle);
+
+    private static native int nativeGetLastMovementOrdinal(long handle);
+
+    private static native int nativeGetLastGestureId(long handle);
+
+    private static native String[] nativeGetDirectionLabels(long handle);
+
+    private static native String[] nativeGetMovementLabels(long handle);
+
+    private static native String[] nativeGetGestureNames(long handle);
+
+    private static native ByteBuffer nativeGetEventBatchBuffer(long handle);
+
+    private static native ByteBuffer nativeGetSampleHistoryBuffer(long handle);
+
+    private static native ByteBuffer nativeGetEventHistoryBuffer(long handle);
+
+    private void handleEventBatch(int eventCount) {
+        MotionLibEventHandler handler = this.handler;
+        if (handler == null) {
+            return;
+        }
+
+        eventBatch.setSize(eventCount);
+        if (handler instanceof MotionLibBatchEventHandler) {
+            ((MotionLibBatchEventHandler) handler).onEventBatch(eventBatch);
+            return;
+        }
+
+        for (int i = 0; i < eventCount; ++i) {
+            switch (eventBatch.getType(i)) {
+                case MotionEventBatch.TYPE_DIRECTION_CHANGE:
+                    handler.onDirectionChanged(eventBatch.getLabel(i));
+                    break;
+                case MotionEventBatch.TYPE_MOVEMENT_DETECTED:
+                    handler.onMovementDetected(eventBatch.getLabel(i));
+                    break;
+                case MotionEventBatch.TYPE_GESTURE_DETECTED:
+                    handler.onGestureDetected(eventBatch.getLabel(i));
+                    break;
+            }
         }
     }
 }
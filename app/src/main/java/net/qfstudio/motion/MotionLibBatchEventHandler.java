@@ -0,0 +1,9 @@
+package net.qfstudio.motion;
+
+/**
+ * Handler receiving all events of a batch at once. When set, the per-event
+ * callbacks of {@link MotionLibEventHandler} are not invoked.
+ */
+public interface MotionLibBatchEventHandler extends MotionLibEventHandler {
+    void onEventBatch(MotionEventBatch batch);
+}
@@ -21,6 +21,7 @@ public class MainActivity extends AppCompatActivity {
     private MotionLib motion;
 
     private Timer refreshTimer;
+    private final float[] recentSamples = new float[3 * 100];
     private TextView meterReadingsTextView;
     private TextView accelerationDirectionTextView;
     private TextView movementDirectionTextView;
@@ -102,11 +103,16 @@ public class MainActivity extends AppCompatActivity {
         this.refreshTimer.schedule(new TimerTask() {
             @Override
             public void run() {
-                float[] readings = motion.getLastMeterReadings();
+                int sampleCount = motion.getHistory().readSamples(recentSamples);
+                if (sampleCount == 0) {
+                    return;
+                }
+
+                int last = (sampleCount - 1) * 3;
                 final String text = String.format(
                         Locale.getDefault(),
                         "x: %+f\ny: %+f\nz: %+f\n",
-                        readings[0], readings[1], readings[2]
+                        recentSamples[last], recentSamples[last + 1], recentSamples[last + 2]
                 );
 
                 runOnUiThread(new Runnable() {
@@ -142,6 +148,13 @@ public class MainActivity extends AppCompatActivity {
         this.cancelMeterUpdateTimer();
     }
 
+    @Override
+    protected void onDestroy() {
+        super.onDestroy();
+
+        this.motion.release();
+    }
+
     void clearScreen() {
         this.accelerationDirectionTextView.setText(R.string.txtAccelerationDirection);
         this.movementDirectionTextView.setText(R.string.txtMovementDirection);